@@ -0,0 +1,774 @@
+/**
+ * @file explore.c
+ * @brief Exhaustive exploration of the interleavings of a workload.
+ *
+ * A state is the next instruction of every process and the resources each
+ * process holds. From a state, every process that can execute its next
+ * instruction is a transition: a request that can be granted, a tryreq or
+ * timed request (granted, or given up if the resources are busy, as time is
+ * not modelled), a release, or a send or receive, which do not change any
+ * resource. A process that runs out of instructions releases what it still
+ * holds. A state in which unfinished processes are left but none can move
+ * is a deadlock. Priorities, periods and arrival times do not matter: every
+ * order is tried, so every reachable deadlock is found, whatever the
+ * scheduler. Writers do not keep readers out while they wait.
+ *
+ * The search is a breadth first search over the levels of the state graph,
+ * with the states of a level expanded by all threads at once. Visited
+ * states are kept in a hash table split into stripes with a lock each. The
+ * first process whose next transition is independent of everything the
+ * other processes can still do (a send or receive, or an instruction on
+ * resources that no other process holds or names any more) is explored
+ * alone: the other orders reach the same states (partial order reduction).
+ * Every transition moves a process on, so the graph has no cycles and the
+ * reduction needs no cycle proviso. A state may be found from several
+ * parents; the one earliest in its level is kept, so the output does not
+ * depend on thread timing.
+ *
+ * Mailboxes are not part of the state: sends and receives never block and
+ * do not change the mailboxes in a simulation.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "proc_structs.h"
+#include "pcb_pool.h"
+#include "explore.h"
+
+#define EX_NONE -1
+#define EX_STRIPES 64
+
+/** An instruction with its resources replaced by ids */
+typedef struct ex_instr_t {
+    instr_types_t type;
+    int *res;        /* resources of a request or release, EX_NONE for an undeclared name */
+    int num_res;
+    bool_t shared;   /* a reqs */
+    bool_t can_fail; /* a tryreq or timed request, which gives up instead of waiting */
+    int skip;        /* next instruction after giving up: past the critical section */
+} ex_instr_t;
+
+/** A process of the model */
+typedef struct ex_proc_t {
+    pcb_t *pcb;
+    ex_instr_t *instrs;
+    int num_instrs;
+    int *last_use; /* by hierarchy root: last instruction naming a resource below it, EX_NONE if none */
+} ex_proc_t;
+
+/** A visited state */
+typedef struct ex_node_t {
+    struct ex_node_t *next;   /* chain of its bucket */
+    struct ex_node_t *parent; /* state it was reached from, NULL for the initial state */
+    int proc;                 /* process that moved from the parent */
+    int level;                /* transitions from the initial state */
+    int order;                /* position in its level */
+    unsigned long hash;
+    unsigned char data[];     /* next instruction of every process, then the holds */
+} ex_node_t;
+
+/** A part of the visited table */
+typedef struct ex_stripe_t {
+    pthread_mutex_t lock;
+    ex_node_t **buckets;
+    size_t mask;
+    size_t count;
+} ex_stripe_t;
+
+struct ex_run_t;
+
+/** A search thread: what it found in the current level, and its scratch space */
+typedef struct ex_worker_t {
+    struct ex_run_t *run;
+    ex_node_t **found; /* new states of the next level */
+    int num_found, cap_found;
+    ex_node_t **dead;  /* deadlock states */
+    int num_dead, cap_dead;
+    long transitions;
+    long reduced;      /* transitions left out by partial order reduction */
+    unsigned char *base, *next;
+    int *holder, *readers, *intent_shared, *intent_exclusive;
+    int *root_procs;   /* processes holding something below each root */
+    int *stamp;
+} ex_worker_t;
+
+/** The whole search */
+typedef struct ex_run_t {
+    ex_proc_t *procs;
+    int num_procs;
+    int num_res;
+    int *parent; /* of each resource in its hierarchy, EX_NONE at the top */
+    int *root;
+    size_t pc_bytes;
+    size_t state_size;
+    ex_stripe_t stripes[EX_STRIPES];
+
+    /* the level being expanded, shared with the workers */
+    ex_node_t **frontier;
+    int num_frontier;
+    atomic_int next_node;
+    int level;
+    atomic_long num_states;
+    ex_worker_t *workers;
+    bool_t quit;
+    pthread_mutex_t setup; /* held until the barriers are sized to the threads that started */
+    pthread_barrier_t start, done;
+} ex_run_t;
+
+static void build_model(ex_run_t *run, pcb_t **pcbs, int num_procs);
+static int skip_target(instr_t *instr, int pc);
+static void expand(ex_worker_t *w, ex_node_t *node);
+static void count_holds(ex_worker_t *w, unsigned char *state);
+static bool_t grantable(ex_worker_t *w, ex_instr_t *ins);
+static bool_t resource_grantable(ex_worker_t *w, int r, bool_t shared);
+static bool_t independent(ex_worker_t *w, unsigned char *state, int p);
+static void apply(ex_worker_t *w, unsigned char *state, int p);
+static void insert(ex_worker_t *w, ex_node_t *parent, int p);
+static bool_t reached_before(ex_node_t *parent, int proc, ex_node_t *other);
+static void push_node(ex_node_t ***list, int *num, int *cap, ex_node_t *node);
+static void run_level(ex_run_t *run);
+static void *ex_worker(void *arg);
+static int compare_found(const void *a, const void *b);
+static int compare_order(const void *a, const void *b);
+static void report_deadlock(ex_run_t *run, ex_worker_t *w, ex_node_t *node);
+
+/** The next instruction of process p in a state */
+#define EX_PC(state, p) (((int *)(state))[p])
+/** The holds of process p on resource r: 0 none, n > 0 shared n times, -1 exclusive */
+#define EX_HOLD(run, state, p, r) (((signed char *)((state) + (run)->pc_bytes))[(size_t)(p) * (run)->num_res + (r)])
+
+/**
+ * @brief Explores every interleaving of the processes and reports the
+ *        reachable deadlocks
+ *
+ * @param procs_loaded The processes that are ready at the start
+ * @param procs_arriving The processes that arrive later, explored as if
+ *        they were there from the start
+ * @param num_threads The number of search threads, 0 for one per processor
+ *
+ * @return The number of deadlock states found
+ */
+long explore_interleavings(pcb_t *procs_loaded, pcb_t *procs_arriving, int num_threads)
+{
+    pcb_t *lists[] = {procs_loaded, procs_arriving};
+    ex_run_t run;
+    ex_worker_t *w;
+    ex_node_t **dead, *node, *chain;
+    pthread_t *threads;
+    pcb_t **pcbs, *pcb;
+    long transitions = 0, reduced = 0, num_dead = 0;
+    int num_procs = 0, cap_frontier, cap_dead = 0, shown = 0;
+    int i, l, t, started, dead_in_level;
+    bool_t complete = TRUE;
+    size_t b;
+
+    for (l = 0; l < 2; l++) {
+        for (pcb = lists[l]; pcb != NULL; pcb = pcb_next(pcb)) num_procs++;
+    }
+    if (num_procs == 0) return 0;
+    pcbs = malloc(num_procs * sizeof(pcb_t *));
+    i = 0;
+    for (l = 0; l < 2; l++) {
+        for (pcb = lists[l]; pcb != NULL; pcb = pcb_next(pcb)) pcbs[i++] = pcb;
+    }
+
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0) num_threads = 1;
+
+    memset(&run, 0, sizeof(ex_run_t));
+    build_model(&run, pcbs, num_procs);
+    printf("Explorer: %d process(es), %d resource(s), %d thread(s)\n", run.num_procs, run.num_res, num_threads);
+
+    for (i = 0; i < EX_STRIPES; i++) {
+        pthread_mutex_init(&run.stripes[i].lock, NULL);
+        run.stripes[i].mask = 15;
+        run.stripes[i].buckets = calloc(run.stripes[i].mask + 1, sizeof(ex_node_t *));
+    }
+    run.workers = calloc(num_threads, sizeof(ex_worker_t));
+    for (t = 0; t < num_threads; t++) {
+        w = &run.workers[t];
+        w->run = &run;
+        w->base = malloc(run.state_size);
+        w->next = malloc(run.state_size);
+        w->holder = malloc((run.num_res + 1) * sizeof(int));
+        w->readers = malloc((run.num_res + 1) * sizeof(int));
+        w->intent_shared = malloc((run.num_res + 1) * sizeof(int));
+        w->intent_exclusive = malloc((run.num_res + 1) * sizeof(int));
+        w->root_procs = malloc((run.num_res + 1) * sizeof(int));
+        w->stamp = malloc((run.num_res + 1) * sizeof(int));
+    }
+
+    /* The initial state: every process at its first instruction, holding nothing */
+    w = &run.workers[0];
+    memset(w->next, 0, run.state_size);
+    run.level = -1;
+    insert(w, NULL, EX_NONE);
+    run.frontier = w->found;
+    run.num_frontier = w->num_found;
+    run.frontier[0]->order = 0;
+    w->found = NULL;
+    w->num_found = w->cap_found = 0;
+    dead = NULL;
+
+    /* A level is shared out by next_node, so the search goes on with the
+       threads that started; the others find nothing */
+    pthread_mutex_init(&run.setup, NULL);
+    pthread_mutex_lock(&run.setup);
+    threads = malloc(num_threads * sizeof(pthread_t));
+    for (started = 1; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, ex_worker, &run.workers[started]) != 0) {
+            fprintf(stderr, "Error: could not start search thread %d\n", started);
+            break;
+        }
+    }
+    pthread_barrier_init(&run.start, NULL, started);
+    pthread_barrier_init(&run.done, NULL, started);
+    pthread_mutex_unlock(&run.setup);
+
+    for (run.level = 0; run.num_frontier > 0; run.level++) {
+        run_level(&run);
+
+        /* Collect the next level and the deadlocks of this one, in a fixed order */
+        free(run.frontier);
+        run.frontier = NULL;
+        run.num_frontier = 0;
+        cap_frontier = 0;
+        dead_in_level = 0;
+        for (t = 0; t < num_threads; t++) {
+            w = &run.workers[t];
+            for (i = 0; i < w->num_found; i++) push_node(&run.frontier, &run.num_frontier, &cap_frontier, w->found[i]);
+            for (i = 0; i < w->num_dead; i++) {
+                push_node(&dead, &dead_in_level, &cap_dead, w->dead[i]);
+            }
+            w->num_found = 0;
+            w->num_dead = 0;
+        }
+        if (run.num_frontier > 0) qsort(run.frontier, run.num_frontier, sizeof(ex_node_t *), compare_found);
+        for (i = 0; i < run.num_frontier; i++) run.frontier[i]->order = i;
+        if (dead_in_level > 0) qsort(dead, dead_in_level, sizeof(ex_node_t *), compare_order);
+        for (i = 0; i < dead_in_level; i++) {
+            if (shown++ < EX_MAX_REPORTS) report_deadlock(&run, &run.workers[0], dead[i]);
+        }
+        num_dead += dead_in_level;
+
+        if (atomic_load(&run.num_states) >= EX_MAX_STATES) {
+            complete = FALSE;
+            break;
+        }
+    }
+    if (shown > EX_MAX_REPORTS) printf("... and %d more deadlock state(s)\n", shown - EX_MAX_REPORTS);
+
+    run.quit = TRUE;
+    pthread_barrier_wait(&run.start);
+    for (t = 1; t < started; t++) pthread_join(threads[t], NULL);
+    pthread_barrier_destroy(&run.start);
+    pthread_barrier_destroy(&run.done);
+    pthread_mutex_destroy(&run.setup);
+
+    for (t = 0; t < num_threads; t++) {
+        w = &run.workers[t];
+        transitions += w->transitions;
+        reduced += w->reduced;
+    }
+    printf("Explored %ld state(s) and %ld transition(s), %ld left out by partial order reduction\n",
+           atomic_load(&run.num_states), transitions, reduced);
+    if (!complete) printf("Search stopped after %d states: not every interleaving was explored\n", EX_MAX_STATES);
+    if (num_dead == 0 && complete) printf("No deadlock is reachable\n");
+    else printf("%ld deadlock state(s) found\n", num_dead);
+
+    for (i = 0; i < EX_STRIPES; i++) {
+        for (b = 0; b <= run.stripes[i].mask; b++) {
+            for (node = run.stripes[i].buckets[b]; node != NULL; node = chain) {
+                chain = node->next;
+                free(node);
+            }
+        }
+        free(run.stripes[i].buckets);
+        pthread_mutex_destroy(&run.stripes[i].lock);
+    }
+    for (t = 0; t < num_threads; t++) {
+        w = &run.workers[t];
+        free(w->found);
+        free(w->dead);
+        free(w->base);
+        free(w->next);
+        free(w->holder);
+        free(w->readers);
+        free(w->intent_shared);
+        free(w->intent_exclusive);
+        free(w->root_procs);
+        free(w->stamp);
+    }
+    for (i = 0; i < run.num_procs; i++) {
+        for (l = 0; l < run.procs[i].num_instrs; l++) free(run.procs[i].instrs[l].res);
+        free(run.procs[i].instrs);
+        free(run.procs[i].last_use);
+    }
+    free(run.procs);
+    free(run.parent);
+    free(run.root);
+    free(run.workers);
+    free(run.frontier);
+    free(dead);
+    free(threads);
+    free(pcbs);
+    return num_dead;
+}
+
+/**
+ * @brief Converts the pcbs into the model: instructions with resource ids,
+ *        the hierarchy of the resources, and for every process the last
+ *        instruction that names each hierarchy
+ */
+static void build_model(ex_run_t *run, pcb_t **pcbs, int num_procs)
+{
+    resource_t *resource;
+    instr_t *instr;
+    ex_instr_t *ins;
+    ex_proc_t *proc;
+    int i, k, n, r;
+
+    run->num_procs = num_procs;
+    run->num_res = get_num_resources();
+    run->parent = malloc((run->num_res + 1) * sizeof(int));
+    run->root = malloc((run->num_res + 1) * sizeof(int));
+    for (r = 0; r < run->num_res; r++) {
+        resource = get_resource(r);
+        run->parent[r] = resource->parent ? resource->parent->id : EX_NONE;
+        while (resource->parent != NULL) resource = resource->parent;
+        run->root[r] = resource->id;
+    }
+
+    run->procs = calloc(num_procs, sizeof(ex_proc_t));
+    for (i = 0; i < num_procs; i++) {
+        proc = &run->procs[i];
+        proc->pcb = pcbs[i];
+        n = 0;
+        for (instr = pcb_mem(pcbs[i])->first_instr; instr != NULL; instr = instr->next) n++;
+        proc->instrs = calloc(n + 1, sizeof(ex_instr_t));
+        proc->num_instrs = n;
+        proc->last_use = malloc((run->num_res + 1) * sizeof(int));
+        for (r = 0; r < run->num_res; r++) proc->last_use[r] = EX_NONE;
+
+        n = 0;
+        for (instr = pcb_mem(pcbs[i])->first_instr; instr != NULL; instr = instr->next, n++) {
+            ins = &proc->instrs[n];
+            ins->type = instr->type;
+            if (instr->type != REQ_OP && instr->type != REL_OP) continue;
+            ins->num_res = instr->set_size ? instr->set_size : 1;
+            ins->res = malloc(ins->num_res * sizeof(int));
+            for (k = 0; k < ins->num_res; k++) {
+                ins->res[k] = instr->set_size ? instr->set_ids[k] : instr->resource_id;
+                if (ins->res[k] >= 0) proc->last_use[run->root[ins->res[k]]] = n;
+            }
+            ins->shared = instr->shared;
+            if (instr->type == REQ_OP && instr->timeout != NO_TIMEOUT) {
+                ins->can_fail = TRUE;
+                ins->skip = skip_target(instr, n);
+            }
+        }
+    }
+
+    run->pc_bytes = num_procs * sizeof(int);
+    run->state_size = run->pc_bytes + (size_t)num_procs * run->num_res;
+}
+
+/**
+ * @brief Returns the instruction a request at <code>pc</code> goes on with
+ *        when it gives up: the one after the release of every resource it
+ *        names, or the next one if they are never all released
+ */
+static int skip_target(instr_t *instr, int pc)
+{
+    instr_t *cur;
+    int open = instr->set_size ? instr->set_size : 1;
+    int i, target = pc;
+
+    for (cur = instr->next; cur != NULL; cur = cur->next) {
+        target++;
+        if (cur->type != REL_OP) continue;
+        for (i = 0; i < (instr->set_size ? instr->set_size : 1); i++) {
+            if (cur->resource_id == (instr->set_size ? instr->set_ids[i] : instr->resource_id)) break;
+        }
+        if (i < (instr->set_size ? instr->set_size : 1) && --open == 0) return target + 1;
+    }
+    return pc + 1;
+}
+
+/**
+ * @brief Generates the successors of a state, or records it as a deadlock
+ *        if unfinished processes are left and none of them can move
+ */
+static void expand(ex_worker_t *w, ex_node_t *node)
+{
+    ex_run_t *run = w->run;
+    ex_instr_t *ins;
+    int p, enabled = 0, unfinished = 0, ample = EX_NONE;
+
+    memcpy(w->base, node->data, run->state_size);
+    count_holds(w, w->base);
+
+    for (p = 0; p < run->num_procs; p++) {
+        if (EX_PC(w->base, p) >= run->procs[p].num_instrs) continue;
+        unfinished++;
+        ins = &run->procs[p].instrs[EX_PC(w->base, p)];
+        if (ins->type == REQ_OP && !ins->can_fail && !grantable(w, ins)) continue;
+        enabled++;
+        if (ample == EX_NONE && independent(w, w->base, p)) ample = p;
+    }
+    if (enabled == 0) {
+        if (unfinished > 0) push_node(&w->dead, &w->num_dead, &w->cap_dead, node);
+        return;
+    }
+
+    if (ample != EX_NONE) {
+        w->reduced += enabled - 1;
+        w->transitions++;
+        memcpy(w->next, w->base, run->state_size);
+        apply(w, w->next, ample);
+        insert(w, node, ample);
+        return;
+    }
+    for (p = 0; p < run->num_procs; p++) {
+        if (EX_PC(w->base, p) >= run->procs[p].num_instrs) continue;
+        ins = &run->procs[p].instrs[EX_PC(w->base, p)];
+        if (ins->type == REQ_OP && !ins->can_fail && !grantable(w, ins)) continue;
+        w->transitions++;
+        memcpy(w->next, w->base, run->state_size);
+        apply(w, w->next, p);
+        insert(w, node, p);
+    }
+}
+
+/**
+ * @brief Sums up the holds of a state per resource: its exclusive holder,
+ *        its readers, the intention locks taken by holds below it, and the
+ *        number of processes holding something in each hierarchy
+ */
+static void count_holds(ex_worker_t *w, unsigned char *state)
+{
+    ex_run_t *run = w->run;
+    int p, r, a, hold;
+
+    for (r = 0; r < run->num_res; r++) {
+        w->holder[r] = EX_NONE;
+        w->readers[r] = 0;
+        w->intent_shared[r] = 0;
+        w->intent_exclusive[r] = 0;
+        w->root_procs[r] = 0;
+        w->stamp[r] = EX_NONE;
+    }
+    for (p = 0; p < run->num_procs; p++) {
+        for (r = 0; r < run->num_res; r++) {
+            hold = EX_HOLD(run, state, p, r);
+            if (hold == 0) continue;
+            if (hold < 0) w->holder[r] = p;
+            else w->readers[r] += hold;
+            for (a = run->parent[r]; a != EX_NONE; a = run->parent[a]) {
+                if (hold < 0) w->intent_exclusive[a]++;
+                else w->intent_shared[a]++;
+            }
+            if (w->stamp[run->root[r]] != p) {
+                w->stamp[run->root[r]] = p;
+                w->root_procs[run->root[r]]++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns TRUE if every resource of a request can be given in its
+ *        mode, with the intention locks on the resources above it
+ */
+static bool_t grantable(ex_worker_t *w, ex_instr_t *ins)
+{
+    int i;
+
+    for (i = 0; i < ins->num_res; i++) {
+        if (!resource_grantable(w, ins->res[i], ins->shared)) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Returns TRUE if resource <code>r</code> can be given in shared or
+ *        exclusive mode, with the intention locks on the resources above it
+ */
+static bool_t resource_grantable(ex_worker_t *w, int r, bool_t shared)
+{
+    int a;
+
+    if (r < 0 || w->holder[r] != EX_NONE || w->intent_exclusive[r] > 0) return FALSE;
+    if (!shared && (w->readers[r] > 0 || w->intent_shared[r] > 0)) return FALSE;
+    for (a = w->run->parent[r]; a != EX_NONE; a = w->run->parent[a]) {
+        if (w->holder[a] != EX_NONE) return FALSE;
+        if (!shared && w->readers[a] > 0) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Returns TRUE if the next transition of process <code>p</code> is
+ *        independent of everything the other processes can still do: no
+ *        other process holds, or will name, a resource of the hierarchies
+ *        it touches
+ */
+static bool_t independent(ex_worker_t *w, unsigned char *state, int p)
+{
+    ex_run_t *run = w->run;
+    ex_instr_t *ins = &run->procs[p].instrs[EX_PC(state, p)];
+    bool_t last = (EX_PC(state, p) + 1 == run->procs[p].num_instrs) ? TRUE : FALSE;
+    int i, q, r, root;
+
+    for (r = 0; r < run->num_res; r++) {
+        /* The hierarchies it touches: those of its instruction, and of its holds if it then finishes */
+        for (i = 0; i < ins->num_res && ins->res[i] != r; i++);
+        if (i == ins->num_res && !(last && EX_HOLD(run, state, p, r) != 0)) continue;
+        root = run->root[r];
+        if (w->root_procs[root] > 1) return FALSE;
+        if (w->root_procs[root] == 1 && w->stamp[root] != p) return FALSE;
+        for (q = 0; q < run->num_procs; q++) {
+            if (q != p && run->procs[q].last_use[root] >= EX_PC(state, q)) return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Executes the next instruction of process <code>p</code> in a state
+ */
+static void apply(ex_worker_t *w, unsigned char *state, int p)
+{
+    ex_run_t *run = w->run;
+    ex_proc_t *proc = &run->procs[p];
+    ex_instr_t *ins = &proc->instrs[EX_PC(state, p)];
+    int i, r;
+
+    switch (ins->type) {
+    case REQ_OP:
+        if (!grantable(w, ins)) {
+            EX_PC(state, p) = ins->skip;
+            break;
+        }
+        for (i = 0; i < ins->num_res; i++) {
+            r = ins->res[i];
+            if (ins->shared) EX_HOLD(run, state, p, r)++;
+            else EX_HOLD(run, state, p, r) = -1;
+        }
+        EX_PC(state, p)++;
+        break;
+    case REL_OP:
+        r = ins->res[0];
+        if (r >= 0 && EX_HOLD(run, state, p, r) > 0) EX_HOLD(run, state, p, r)--;
+        else if (r >= 0) EX_HOLD(run, state, p, r) = 0;
+        EX_PC(state, p)++;
+        break;
+    default:
+        EX_PC(state, p)++;
+        break;
+    }
+    if (EX_PC(state, p) >= proc->num_instrs) {
+        for (r = 0; r < run->num_res; r++) EX_HOLD(run, state, p, r) = 0;
+    }
+}
+
+/**
+ * @brief Adds the state in the worker's next buffer, reached from
+ *        <code>parent</code> by process <code>p</code>, to the next level
+ *        unless it was visited before
+ */
+static void insert(ex_worker_t *w, ex_node_t *parent, int p)
+{
+    ex_run_t *run = w->run;
+    ex_stripe_t *stripe;
+    ex_node_t *node, *added, **buckets, *chain;
+    unsigned long hash = 14695981039346656037UL;
+    size_t i, b, mask;
+
+    for (i = 0; i < run->state_size; i++) hash = (hash ^ w->next[i]) * 1099511628211UL;
+    stripe = &run->stripes[hash % EX_STRIPES];
+
+    pthread_mutex_lock(&stripe->lock);
+    for (node = stripe->buckets[(hash / EX_STRIPES) & stripe->mask]; node != NULL; node = node->next) {
+        if (node->hash != hash || memcmp(node->data, w->next, run->state_size) != 0) continue;
+        /* Found again in the same level: keep the parent that comes first */
+        if (node->level == run->level + 1 && reached_before(parent, p, node)) {
+            node->parent = parent;
+            node->proc = p;
+        }
+        pthread_mutex_unlock(&stripe->lock);
+        return;
+    }
+    if (atomic_load(&run->num_states) >= EX_MAX_STATES) {
+        /* Out of room: the search ends incomplete after this level */
+        pthread_mutex_unlock(&stripe->lock);
+        return;
+    }
+
+    added = malloc(sizeof(ex_node_t) + run->state_size);
+    memcpy(added->data, w->next, run->state_size);
+    added->hash = hash;
+    added->parent = parent;
+    added->proc = p;
+    added->level = run->level + 1;
+    added->order = 0;
+    b = (hash / EX_STRIPES) & stripe->mask;
+    added->next = stripe->buckets[b];
+    stripe->buckets[b] = added;
+
+    if (++stripe->count > 2 * (stripe->mask + 1)) {
+        mask = 2 * stripe->mask + 1;
+        buckets = calloc(mask + 1, sizeof(ex_node_t *));
+        for (b = 0; b <= stripe->mask; b++) {
+            for (node = stripe->buckets[b]; node != NULL; node = chain) {
+                chain = node->next;
+                node->next = buckets[(node->hash / EX_STRIPES) & mask];
+                buckets[(node->hash / EX_STRIPES) & mask] = node;
+            }
+        }
+        free(stripe->buckets);
+        stripe->buckets = buckets;
+        stripe->mask = mask;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    atomic_fetch_add(&run->num_states, 1);
+    push_node(&w->found, &w->num_found, &w->cap_found, added);
+}
+
+/**
+ * @brief Returns TRUE if reaching a state from <code>parent</code> by
+ *        <code>proc</code> comes before the way <code>other</code> was reached
+ */
+static bool_t reached_before(ex_node_t *parent, int proc, ex_node_t *other)
+{
+    if (parent->order != other->parent->order) return parent->order < other->parent->order ? TRUE : FALSE;
+    return proc < other->proc ? TRUE : FALSE;
+}
+
+/**
+ * @brief Appends a node to a growing list
+ */
+static void push_node(ex_node_t ***list, int *num, int *cap, ex_node_t *node)
+{
+    ex_node_t **grown;
+
+    if (*num == *cap) {
+        grown = realloc(*list, (*cap ? 2 * *cap : 64) * sizeof(ex_node_t *));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for explorer states\n");
+            exit(EXIT_FAILURE);
+        }
+        *list = grown;
+        *cap = *cap ? 2 * *cap : 64;
+    }
+    (*list)[(*num)++] = node;
+}
+
+/**
+ * @brief Expands the current level on all threads
+ */
+static void run_level(ex_run_t *run)
+{
+    int i;
+
+    atomic_store(&run->next_node, 0);
+    pthread_barrier_wait(&run->start);
+    while ((i = atomic_fetch_add(&run->next_node, 1)) < run->num_frontier) {
+        expand(&run->workers[0], run->frontier[i]);
+    }
+    pthread_barrier_wait(&run->done);
+}
+
+/**
+ * @brief Search thread: expands states whenever the main thread starts a level
+ */
+static void *ex_worker(void *arg)
+{
+    ex_worker_t *w = arg;
+    ex_run_t *run = w->run;
+    int i;
+
+    pthread_mutex_lock(&run->setup);
+    pthread_mutex_unlock(&run->setup);
+    for (;;) {
+        pthread_barrier_wait(&run->start);
+        if (run->quit) break;
+        while ((i = atomic_fetch_add(&run->next_node, 1)) < run->num_frontier) {
+            expand(w, run->frontier[i]);
+        }
+        pthread_barrier_wait(&run->done);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Orders the states of a level by the way they were reached: by
+ *        their parent, then by the process that moved
+ */
+static int compare_found(const void *a, const void *b)
+{
+    const ex_node_t *x = *(ex_node_t * const *)a;
+    const ex_node_t *y = *(ex_node_t * const *)b;
+
+    if (x->parent->order != y->parent->order) return x->parent->order < y->parent->order ? -1 : 1;
+    if (x->proc != y->proc) return x->proc < y->proc ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Orders the states of a level by their position in it
+ */
+static int compare_order(const void *a, const void *b)
+{
+    const ex_node_t *x = *(ex_node_t * const *)a;
+    const ex_node_t *y = *(ex_node_t * const *)b;
+
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+/**
+ * @brief Prints a deadlock state: what every stuck process waits for, and
+ *        the order in which the processes ran to get there
+ */
+static void report_deadlock(ex_run_t *run, ex_worker_t *w, ex_node_t *node)
+{
+    ex_instr_t *ins;
+    ex_node_t *n;
+    int *trace;
+    int p, q, r, i, len = 0;
+
+    memcpy(w->base, node->data, run->state_size);
+    count_holds(w, w->base);
+
+    printf("Deadlock:");
+    for (p = 0; p < run->num_procs; p++) {
+        if (EX_PC(w->base, p) >= run->procs[p].num_instrs) continue;
+        ins = &run->procs[p].instrs[EX_PC(w->base, p)];
+        for (i = 0; i < ins->num_res - 1 && resource_grantable(w, ins->res[i], ins->shared); i++);
+        r = ins->res[i];
+        printf(" %s waits for %s", pcb_mem(run->procs[p].pcb)->name,
+               r >= 0 ? get_resource(r)->name : "an undeclared resource");
+        if (r >= 0 && w->holder[r] != EX_NONE) {
+            printf(" held by %s", pcb_mem(run->procs[w->holder[r]].pcb)->name);
+        } else if (r >= 0) {
+            for (q = 0; q < run->num_procs; q++) {
+                if (EX_HOLD(run, w->base, q, r) != 0) break;
+            }
+            if (q < run->num_procs) printf(" held by %s", pcb_mem(run->procs[q].pcb)->name);
+        }
+        printf(";");
+    }
+    printf("\n");
+
+    trace = malloc((node->level + 1) * sizeof(int));
+    for (n = node; n->parent != NULL; n = n->parent) trace[len++] = n->proc;
+    printf("  after:");
+    for (i = len - 1; i >= 0; i--) printf(" %s", pcb_mem(run->procs[trace[i]].pcb)->name);
+    printf("\n");
+    free(trace);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file explore.h
+ * @description Exhaustive exploration of the interleavings of a workload,
+ *              to find every reachable deadlock instead of the one the
+ *              simulated schedule runs into.
+ */
+#ifndef _EXPLORE_H
+#define _EXPLORE_H
+
+#include "proc_structs.h"
+
+/** Largest number of states stored before the search gives up */
+#ifndef EX_MAX_STATES
+#define EX_MAX_STATES (1 << 22)
+#endif
+
+/** Deadlocks printed in full, with the schedule that leads to them */
+#ifndef EX_MAX_REPORTS
+#define EX_MAX_REPORTS 10
+#endif
+
+/**
+ * Explores every order in which the processes of both lists can execute
+ * their instructions, on <code>num_threads</code> threads, and prints every
+ * reachable state in which unfinished processes can no longer move.
+ *
+ * @return The number of deadlock states found
+ */
+long explore_interleavings(pcb_t *procs_loaded, pcb_t *procs_arriving, int num_threads);
+
+#endif
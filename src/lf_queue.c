@@ -0,0 +1,140 @@
+/**
+ * @file lf_queue.c
+ * @brief A lock-free bounded MPMC queue of pcbs.
+ *
+ * Every slot of the ring carries a sequence number. A producer may fill slot
+ * pos when its sequence equals pos, a consumer may empty it when its sequence
+ * equals pos + 1. Producers and consumers claim positions with a single CAS,
+ * so no thread ever holds a lock and the slots are never freed while the
+ * queue is alive (no hazard pointers or epochs are needed to reclaim them).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "lf_queue.h"
+
+/**
+ * @brief Initialises an empty queue.
+ *
+ * The capacity is rounded up to a power of two so that positions can be
+ * mapped to slots with a mask.
+ *
+ * @param queue The queue to initialise
+ * @param capacity The minimum number of pcbs the queue must hold
+ *
+ * @return TRUE on success, FALSE if the slots could not be allocated
+ */
+bool_t init_lf_queue(lf_pcb_queue_t *queue, size_t capacity)
+{
+    size_t size = 2;
+    size_t i;
+
+    if (queue == NULL) return FALSE;
+
+    while (size < capacity) size <<= 1;
+
+    queue->cells = malloc(size * sizeof(lf_cell_t));
+    if (queue->cells == NULL) {
+        fprintf(stderr, "Memory allocation failed for lock-free queue\n");
+        return FALSE;
+    }
+
+    for (i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].seq, i);
+        queue->cells[i].pcb = NULL;
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+
+    return TRUE;
+}
+
+/**
+ * Enqueues process <code>pcb</code> to <code>queue</code>.
+ *
+ * @param[in] pcb
+ *     process to enqueue
+ * @param[in] queue
+ *     queue to which the process must be enqueued
+ * @return TRUE if the process was enqueued, FALSE if the queue is full
+ */
+bool_t lf_enqueue_pcb(pcb_t *pcb, lf_pcb_queue_t *queue)
+{
+    lf_cell_t *cell;
+    size_t pos, seq;
+    intptr_t diff;
+
+    if (pcb == NULL || queue == NULL) return FALSE;
+
+    pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            /* Slot is free: try to claim this position */
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            /* Slot still holds a pcb from the previous lap: queue is full */
+            return FALSE;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->pcb = pcb;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return TRUE;
+}
+
+/**
+ * Dequeues a process from queue <code>queue</code>.
+ *
+ * @param[in] queue
+ *     queue from which to dequeue a process
+ * @return dequeued process, or NULL if the queue is empty
+ */
+pcb_t *lf_dequeue_pcb(lf_pcb_queue_t *queue)
+{
+    lf_cell_t *cell;
+    pcb_t *pcb;
+    size_t pos, seq;
+    intptr_t diff;
+
+    if (queue == NULL) return NULL;
+
+    pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            /* Slot is filled: try to claim this position */
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            /* Nothing has been enqueued at this position yet */
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    pcb = cell->pcb;
+    /* Hand the slot back to producers for the next lap */
+    atomic_store_explicit(&cell->seq, pos + queue->mask + 1, memory_order_release);
+    return pcb;
+}
+
+/**
+ * @brief Frees the slots of the queue
+ */
+void free_lf_queue(lf_pcb_queue_t *queue)
+{
+    if (queue != NULL) {
+        free(queue->cells);
+        queue->cells = NULL;
+    }
+}
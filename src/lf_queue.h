@@ -0,0 +1,47 @@
+/**
+ * @file lf_queue.h
+ * @description A lock-free multi-producer/multi-consumer queue of pcbs that
+ *              can be shared between scheduler threads.
+ */
+#ifndef _LF_QUEUE_H
+#define _LF_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "proc_structs.h"
+
+#define LF_CACHE_LINE 64
+
+/** A slot in the ring: seq tells producers and consumers whose turn it is */
+typedef struct lf_cell_t {
+    atomic_size_t seq;
+    struct pcb_t *pcb;
+} lf_cell_t;
+
+/**
+ * A bounded array based MPMC queue. The enqueue and dequeue positions live on
+ * their own cache lines so that producers and consumers do not false share.
+ */
+typedef struct lf_pcb_queue_t {
+    lf_cell_t *cells;
+    size_t mask;
+    char pad0[LF_CACHE_LINE];
+    atomic_size_t enqueue_pos;
+    char pad1[LF_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t dequeue_pos;
+    char pad2[LF_CACHE_LINE - sizeof(atomic_size_t)];
+} lf_pcb_queue_t;
+
+/** Initialises <code>queue</code> to hold at least <code>capacity</code> pcbs */
+bool_t init_lf_queue(lf_pcb_queue_t *queue, size_t capacity);
+
+/** Enqueues <code>pcb</code>, returns FALSE if the queue is full */
+bool_t lf_enqueue_pcb(pcb_t *pcb, lf_pcb_queue_t *queue);
+
+/** Dequeues a pcb, returns NULL if the queue is empty */
+pcb_t *lf_dequeue_pcb(lf_pcb_queue_t *queue);
+
+/** Frees the memory of <code>queue</code> (not the pcbs it may still hold) */
+void free_lf_queue(lf_pcb_queue_t *queue);
+
+#endif
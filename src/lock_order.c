@@ -0,0 +1,317 @@
+/**
+ * @file lock_order.c
+ * @brief Static lock order analysis of the instruction lists.
+ *
+ * The resource order graph has an edge Ri -> Rj when a process requests Rj
+ * while it holds Ri. Two processes that take the same resources in
+ * opposite orders form a cycle, which can deadlock. Only the resources of
+ * the latest request still held get an edge to the next request: every
+ * resource held before has a path to them already, so the graph has a
+ * cycle exactly when the graph of all held/requested pairs has one, and it
+ * is built in one pass over the instructions. Cycles are then found as the
+ * strongly connected components of the graph (Tarjan), also in linear time.
+ *
+ * A tryreq or a timed request gives up instead of waiting and gets no edge.
+ * A reqs counts as a req, and the intention locks of a hierarchy are not
+ * modelled.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "proc_structs.h"
+#include "pcb_pool.h"
+#include "lock_order.h"
+
+/** An edge of the resource order graph */
+typedef struct order_edge_t {
+    int from;
+    int to;
+    pcb_t *pcb; /* the first process that requested to while holding from */
+} order_edge_t;
+
+/** The resource order graph, with the edges of each resource contiguous */
+typedef struct order_graph_t {
+    int num_res;
+    int num_edges;
+    int capacity;
+    order_edge_t *edges;
+    int *first; /* edges of resource r are first[r] .. first[r + 1] - 1 once sorted */
+} order_graph_t;
+
+/** The resources a process holds while its instructions are walked, in order of their requests */
+typedef struct held_list_t {
+    int *prev;
+    int *next;
+    int *request; /* number of the request that took the resource */
+    bool_t *held;
+    int tail;
+} held_list_t;
+
+static void add_process(order_graph_t *graph, held_list_t *held, pcb_t *pcb);
+static void add_edge(order_graph_t *graph, int from, int to, pcb_t *pcb);
+static void sort_edges(order_graph_t *graph);
+static int find_cycles(order_graph_t *graph);
+static void print_cycle(order_graph_t *graph, int start, int *component, int *on_path);
+
+/**
+ * @brief Checks the order in which the processes of a workload acquire
+ *        their resources
+ *
+ * @param procs_loaded The processes that are ready at the start
+ * @param procs_arriving The processes that arrive later
+ *
+ * @return The number of cycles found
+ */
+int check_lock_order(pcb_t *procs_loaded, pcb_t *procs_arriving)
+{
+    pcb_t *lists[] = {procs_loaded, procs_arriving};
+    order_graph_t graph;
+    held_list_t held;
+    pcb_t *pcb;
+    int cycles, l;
+
+    graph.num_res = get_num_resources();
+    graph.num_edges = 0;
+    graph.capacity = 16;
+    graph.edges = malloc(graph.capacity * sizeof(order_edge_t));
+    graph.first = calloc(graph.num_res + 1, sizeof(int));
+
+    held.prev = malloc((graph.num_res + 1) * sizeof(int));
+    held.next = malloc((graph.num_res + 1) * sizeof(int));
+    held.request = malloc((graph.num_res + 1) * sizeof(int));
+    held.held = calloc(graph.num_res + 1, sizeof(bool_t));
+
+    for (l = 0; l < 2; l++) {
+        for (pcb = lists[l]; pcb != NULL; pcb = pcb_next(pcb)) add_process(&graph, &held, pcb);
+    }
+    sort_edges(&graph);
+
+    printf("Lock order analysis: %d resource(s), %d order edge(s)\n", graph.num_res, graph.num_edges);
+    cycles = find_cycles(&graph);
+    if (cycles == 0) printf("No lock order cycles\n");
+    else printf("%d lock order cycle(s), each a potential deadlock\n", cycles);
+
+    free(held.prev);
+    free(held.next);
+    free(held.request);
+    free(held.held);
+    free(graph.edges);
+    free(graph.first);
+    return cycles;
+}
+
+/**
+ * @brief Adds the edges of one process to the graph
+ *
+ * The held resources are a list in order of their requests, with the
+ * resource ids as nodes, so a rel unlinks its resource in O(1).
+ */
+static void add_process(order_graph_t *graph, held_list_t *held, pcb_t *pcb)
+{
+    instr_t *instr;
+    int requests = 0, id, r, i, n;
+
+    held->tail = -1;
+    for (instr = pcb_mem(pcb)->first_instr; instr != NULL; instr = instr->next) {
+        if (instr->resource_id < 0) continue;
+        if (instr->type == REL_OP) {
+            id = instr->resource_id;
+            if (!held->held[id]) continue;
+            held->held[id] = FALSE;
+            if (held->prev[id] >= 0) held->next[held->prev[id]] = held->next[id];
+            if (held->next[id] >= 0) held->prev[held->next[id]] = held->prev[id];
+            else held->tail = held->prev[id];
+            continue;
+        }
+        if (instr->type != REQ_OP) continue;
+
+        n = instr->set_size ? instr->set_size : 1;
+        if (instr->timeout == NO_TIMEOUT) {
+            /* The resources of the latest request still held come before every resource requested */
+            for (r = held->tail; r >= 0 && held->request[r] == held->request[held->tail]; r = held->prev[r]) {
+                for (i = 0; i < n; i++) add_edge(graph, r, instr->set_size ? instr->set_ids[i] : instr->resource_id, pcb);
+            }
+        }
+        requests++;
+        for (i = 0; i < n; i++) {
+            id = instr->set_size ? instr->set_ids[i] : instr->resource_id;
+            if (held->held[id]) continue;
+            held->held[id] = TRUE;
+            held->request[id] = requests;
+            held->prev[id] = held->tail;
+            held->next[id] = -1;
+            if (held->tail >= 0) held->next[held->tail] = id;
+            held->tail = id;
+        }
+    }
+    /* Whatever the process still holds at its end is released on termination */
+    for (r = held->tail; r >= 0; r = held->prev[r]) held->held[r] = FALSE;
+}
+
+/**
+ * @brief Appends an edge, growing the edge array as needed
+ */
+static void add_edge(order_graph_t *graph, int from, int to, pcb_t *pcb)
+{
+    if (graph->num_edges == graph->capacity) {
+        graph->capacity *= 2;
+        graph->edges = realloc(graph->edges, graph->capacity * sizeof(order_edge_t));
+    }
+    graph->edges[graph->num_edges].from = from;
+    graph->edges[graph->num_edges].to = to;
+    graph->edges[graph->num_edges].pcb = pcb;
+    graph->num_edges++;
+}
+
+/**
+ * @brief Sorts the edges by their from resource with a counting sort, so
+ *        that the edges of resource r are first[r] .. first[r + 1] - 1, and
+ *        drops repeated edges, keeping the one added first
+ */
+static void sort_edges(order_graph_t *graph)
+{
+    order_edge_t *sorted = malloc((graph->num_edges + 1) * sizeof(order_edge_t));
+    int *pos = malloc((graph->num_res + 1) * sizeof(int));
+    int *seen = malloc((graph->num_res + 1) * sizeof(int)); /* last from resource with an edge to each resource */
+    int i, r, e, start;
+
+    for (i = 0; i < graph->num_edges; i++) graph->first[graph->edges[i].from + 1]++;
+    for (i = 0; i < graph->num_res; i++) graph->first[i + 1] += graph->first[i];
+    for (i = 0; i <= graph->num_res; i++) pos[i] = graph->first[i];
+    for (i = 0; i < graph->num_edges; i++) sorted[pos[graph->edges[i].from]++] = graph->edges[i];
+
+    /* pos[r] is now the end of the edges of r; compact them in place */
+    for (i = 0; i < graph->num_res; i++) seen[i] = -1;
+    for (r = 0, i = 0; r < graph->num_res; r++) {
+        start = graph->first[r];
+        graph->first[r] = i;
+        for (e = start; e < pos[r]; e++) {
+            if (seen[sorted[e].to] == r) continue;
+            seen[sorted[e].to] = r;
+            sorted[i++] = sorted[e];
+        }
+    }
+    graph->first[graph->num_res] = i;
+    graph->num_edges = i;
+
+    free(graph->edges);
+    free(pos);
+    free(seen);
+    graph->edges = sorted;
+}
+
+/**
+ * @brief Finds the strongly connected components of the graph with an
+ *        iterative Tarjan search and prints a cycle through each one that
+ *        has more than one resource or an edge to itself
+ *
+ * @return The number of cycles printed
+ */
+static int find_cycles(order_graph_t *graph)
+{
+    int n = graph->num_res;
+    int *index = malloc((n + 1) * sizeof(int));
+    int *low = malloc((n + 1) * sizeof(int));
+    int *component = malloc((n + 1) * sizeof(int));
+    int *stack = malloc((n + 1) * sizeof(int));
+    int *calls = malloc((n + 1) * sizeof(int)); /* the search path, by resource */
+    int *edge = malloc((n + 1) * sizeof(int)); /* next edge to follow from each resource on the path */
+    int *on_path = malloc((n + 1) * sizeof(int));
+    bool_t *on_stack = calloc(n + 1, sizeof(bool_t));
+    int next_index = 0, top = 0, depth, cycles = 0, size, start, u, v, w, e;
+
+    for (u = 0; u < n; u++) {
+        index[u] = -1;
+        component[u] = -1;
+        on_path[u] = -1;
+    }
+
+    for (start = 0; start < n; start++) {
+        if (index[start] >= 0) continue;
+        depth = 0;
+        calls[depth++] = start;
+        index[start] = low[start] = next_index++;
+        edge[start] = graph->first[start];
+        stack[top++] = start;
+        on_stack[start] = TRUE;
+
+        while (depth > 0) {
+            u = calls[depth - 1];
+            if (edge[u] < graph->first[u + 1]) {
+                v = graph->edges[edge[u]++].to;
+                if (index[v] < 0) {
+                    index[v] = low[v] = next_index++;
+                    edge[v] = graph->first[v];
+                    stack[top++] = v;
+                    on_stack[v] = TRUE;
+                    calls[depth++] = v;
+                } else if (on_stack[v] && index[v] < low[u]) {
+                    low[u] = index[v];
+                }
+                continue;
+            }
+            depth--;
+            if (depth > 0 && low[u] < low[calls[depth - 1]]) low[calls[depth - 1]] = low[u];
+            if (low[u] != index[u]) continue;
+
+            /* u is the root of a component: pop it */
+            size = 0;
+            do {
+                w = stack[--top];
+                on_stack[w] = FALSE;
+                component[w] = u;
+                size++;
+            } while (w != u);
+
+            for (e = graph->first[u]; size == 1 && e < graph->first[u + 1]; e++) {
+                if (graph->edges[e].to == u) size = 2;
+            }
+            if (size > 1) {
+                print_cycle(graph, u, component, on_path);
+                cycles++;
+            }
+        }
+    }
+
+    free(index);
+    free(low);
+    free(component);
+    free(stack);
+    free(calls);
+    free(edge);
+    free(on_path);
+    free(on_stack);
+    return cycles;
+}
+
+/**
+ * @brief Prints a cycle inside the component of <code>start</code>, found
+ *        by following edges within the component until a resource repeats
+ *
+ * @param on_path Position of each resource on the walk, -1 for none; it is
+ *        reset for the resources walked
+ */
+static void print_cycle(order_graph_t *graph, int start, int *component, int *on_path)
+{
+    int *walk = malloc((graph->num_res + 1) * sizeof(int));
+    order_edge_t **taken = malloc((graph->num_res + 1) * sizeof(order_edge_t *));
+    int len = 0, u = start, e, i;
+
+    while (on_path[u] < 0) {
+        on_path[u] = len;
+        walk[len] = u;
+        for (e = graph->first[u]; component[graph->edges[e].to] != component[start]; e++);
+        taken[len++] = &graph->edges[e];
+        u = graph->edges[e].to;
+    }
+
+    printf("Lock order cycle:");
+    for (i = on_path[u]; i < len; i++) {
+        printf(" %s -(%s)->", get_resource(walk[i])->name, pcb_mem(taken[i]->pcb)->name);
+    }
+    printf(" %s\n", get_resource(u)->name);
+
+    for (i = 0; i < len; i++) on_path[walk[i]] = -1;
+    free(walk);
+    free(taken);
+}
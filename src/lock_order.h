@@ -0,0 +1,21 @@
+/**
+ * @file lock_order.h
+ * @description Static lock order analysis of a workload: finds the cycles
+ *              of resources that processes acquire in conflicting orders,
+ *              without simulating it.
+ */
+#ifndef _LOCK_ORDER_H
+#define _LOCK_ORDER_H
+
+#include "proc_structs.h"
+
+/**
+ * Builds the resource order graph of the processes in both lists and prints
+ * every cycle in it as a potential deadlock, with the processes that make
+ * up each edge.
+ *
+ * @return The number of cycles found
+ */
+int check_lock_order(pcb_t *procs_loaded, pcb_t *procs_arriving);
+
+#endif
@@ -5,6 +5,11 @@
 #include <time.h>
 #include "logger.h"
 
+#define LOG_LINE_SZ 256
+
+/* Capture buffer of the current thread, NULL when logging directly */
+static _Thread_local log_capture_t *capture = NULL;
+
 /* Open the file for the current thread: in append mode */
 FILE* open_logfile() {
     FILE* fptr = NULL;
@@ -31,83 +36,177 @@ void close_logfile(FILE* fptr) {
     fclose(fptr);
 }
 
-/* Logging request resource */
-void log_request_acquired(char* proc_name, char* resource_name) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s req %s: acquired\n", proc_name, resource_name);    
-    printf("%s req %s: acquired\n", proc_name, resource_name);    
-    fflush(fptr);
-    close_logfile(fptr);
+/* Append text to a growing capture buffer */
+static void append_text(char **text, size_t *len, size_t *cap, const char *line) {
+    size_t n = strlen(line);
+    char *grown;
+
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = (*cap == 0) ? 1024 : *cap;
+        while (*len + n + 1 > new_cap) new_cap *= 2;
+        grown = realloc(*text, new_cap);
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for log capture\n");
+            return;
+        }
+        *text = grown;
+        *cap = new_cap;
+    }
+    memcpy(*text + *len, line, n + 1);
+    *len += n;
 }
 
-void log_request_waiting(char* proc_name, char* resource_name) {
+/* Write a log line to stdout and, if to_file, to the logfile (or capture it).
+   A line longer than LOG_LINE_SZ, with long names in it, is formatted again
+   into a buffer of its own size rather than cut. */
+static void log_line(int to_file, const char *fmt, ...) {
+    char buf[LOG_LINE_SZ];
+    char *line = buf;
+    FILE* fptr;
+    va_list args, again;
+    int len;
+
+    va_start(args, fmt);
+    va_copy(again, args);
+    len = vsnprintf(buf, LOG_LINE_SZ, fmt, args);
+    if (len >= LOG_LINE_SZ) {
+        line = malloc(len + 1);
+        if (line != NULL) vsnprintf(line, len + 1, fmt, again);
+        else line = buf; /* out of memory: the line is cut */
+    }
+    va_end(again);
+    va_end(args);
+
+    if (capture) {
+        if (to_file) append_text(&capture->file_text, &capture->file_len, &capture->file_cap, line);
+        append_text(&capture->out_text, &capture->out_len, &capture->out_cap, line);
+    } else {
+        fptr = open_logfile();
+        if (to_file) fprintf(fptr, "%s", line);
+        printf("%s", line);
+        fflush(fptr);
+        close_logfile(fptr);
+    }
+    if (line != buf) free(line);
+}
+
+/* Redirect the logs of the calling thread into buf until log_capture_end() */
+void log_capture_begin(log_capture_t *buf) {
+    memset(buf, 0, sizeof(log_capture_t));
+    capture = buf;
+}
+
+/* Stop capturing the logs of the calling thread */
+void log_capture_end() {
+    capture = NULL;
+}
+
+/* Write captured logs to stdout and the logfile, and free the buffer */
+void log_capture_flush(log_capture_t *buf) {
     FILE* fptr = open_logfile();
-    fprintf(fptr, "%s req %s: waiting\n", proc_name, resource_name);    
-    printf("%s req %s: waiting\n", proc_name, resource_name);    
+    if (buf->file_text) fprintf(fptr, "%s", buf->file_text);
+    if (buf->out_text) printf("%s", buf->out_text);
     fflush(fptr);
     close_logfile(fptr);
+    free(buf->file_text);
+    free(buf->out_text);
+    memset(buf, 0, sizeof(log_capture_t));
+}
+
+/* Logging request resource */
+void log_request_acquired(char* proc_name, char* op, char* resource_name) {
+    log_line(1, "%s %s %s: acquired\n", proc_name, op, resource_name);
+}
+
+void log_request_waiting(char* proc_name, char* op, char* resource_name) {
+    log_line(1, "%s %s %s: waiting\n", proc_name, op, resource_name);
+}
+
+void log_request_failed(char* proc_name, char* resource_name) {
+    log_line(1, "%s tryreq %s: failed\n", proc_name, resource_name);
+}
+
+void log_request_timed_out(char* proc_name, char* op, char* resource_name) {
+    log_line(1, "%s %s %s: timed out\n", proc_name, op, resource_name);
 }
 
 void log_request_ready(char* proc_name) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s: ready\n", proc_name);    
-    printf("%s: ready\n", proc_name);    
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "%s: ready\n", proc_name);
 }
 
 void log_release_released(char* proc_name, char* resource_name) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s rel %s: released\n", proc_name, resource_name);
-    printf("%s rel %s: released\n", proc_name, resource_name);
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "%s rel %s: released\n", proc_name, resource_name);
 }
 
 void log_release_error(char* proc_name, char* resource_name) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s rel %s: error nothing to release\n", proc_name, resource_name);
-    printf("%s rel %s: error nothing to release\n", proc_name, resource_name);
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "%s rel %s: error nothing to release\n", proc_name, resource_name);
+}
+
+void log_leaked_resource(char *proc_name, char *resource_name) {
+    log_line(1, "%s terminated holding %s: released\n", proc_name, resource_name);
 }
 
 void log_terminated(char *proc_name) {
-    FILE* fptr = open_logfile();
-//    fprintf(fptr, "%s terminated\n", proc_name);
-    printf("%s terminated\n", proc_name);
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(0, "%s terminated\n", proc_name);
+}
+
+void log_arrival(char *proc_name) {
+    log_line(0, "New process arriving: %s\n", proc_name);
+}
+
+void log_priority_inherited(char *proc_name, int priority, char *waiter_name) {
+    log_line(1, "%s inherits priority %d from %s\n", proc_name, priority, waiter_name);
+}
+
+void log_priority_restored(char *proc_name, int priority) {
+    log_line(1, "%s priority restored to %d\n", proc_name, priority);
+}
+
+void log_priority_ceiling(char *proc_name, int priority, char *resource_name) {
+    log_line(1, "%s runs at priority %d, the ceiling of %s\n", proc_name, priority, resource_name);
+}
+
+void log_job_release(char *proc_name, int job, long time) {
+    log_line(0, "%s job %d released at %ld\n", proc_name, job, time);
+}
+
+void log_deadline_miss(char *proc_name, int job, long deadline, long completed) {
+    log_line(1, "%s job %d missed its deadline %ld: completed at %ld (lateness %ld)\n",
+             proc_name, job, deadline, completed, completed - deadline);
+}
+
+void log_rt_summary(char *proc_name, int jobs, int misses, long max_lateness) {
+    log_line(1, "%s: %d job(s), %d deadline miss(es), max lateness %ld\n",
+             proc_name, jobs, misses, max_lateness);
+}
+
+void log_dispatch_summary(long dispatches, long blocked, long skipped) {
+    log_line(1, "Dispatches: %ld, %ld blocked on their first instruction, %ld skipped\n",
+             dispatches, blocked, skipped);
+}
+
+void log_stream_summary(long terminated, long time, long jobs, long misses, long max_lateness) {
+    log_line(1, "Streamed: %ld process(es) terminated by time %ld\n", terminated, time);
+    if (jobs > 0) log_line(1, "Streamed: %ld job(s), %ld deadline miss(es), max lateness %ld\n",
+                           jobs, misses, max_lateness);
+}
+
+void log_no_instruction() {
+    log_line(0, "Error: No instruction to execute\n");
 }
 
 void log_send(char *proc_name, char* msg, char* mailbox) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s sending message%s to mailbox %s\n", proc_name, msg, mailbox);
-    printf("%s sending message%s to mailbox %s\n", proc_name, msg, mailbox);
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "%s sending message%s to mailbox %s\n", proc_name, msg, mailbox);
 }
 
 void log_recv(char *proc_name, char* msg, char* mailbox) {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "%s received message%s from mailbox %s\n", proc_name, msg, mailbox); 
-    printf("%s received message%s from mailbox %s\n", proc_name, msg, mailbox); 
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "%s received message%s from mailbox %s\n", proc_name, msg, mailbox); 
 }
 
 void log_deadlock_detected() {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "Deadlock detected:");
-    printf("Deadlock detected:");
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "Deadlock detected:");
 }
 
 void log_blocked_procs() {
-    FILE* fptr = open_logfile();
-    fprintf(fptr, "No deadlock detected, but blocked process(es) found:");
-    printf("No deadlock detected, but blocked process(es) found:");
-    fflush(fptr);
-    close_logfile(fptr);
+    log_line(1, "No deadlock detected, but blocked process(es) found:");
 }
@@ -6,16 +6,43 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stddef.h>
+
+/** Logs of one thread held back so that they can be written in a fixed order */
+typedef struct log_capture_t {
+    char *file_text;
+    size_t file_len, file_cap;
+    char *out_text;
+    size_t out_len, out_cap;
+} log_capture_t;
+
 /* Functions */
-void log_request_acquired(char* proc_name, char* resource_name);
-void log_request_waiting(char* proc_name, char* resource_name);
+void log_request_acquired(char* proc_name, char* op, char* resource_name);
+void log_request_waiting(char* proc_name, char* op, char* resource_name);
+void log_request_failed(char* proc_name, char* resource_name);
+void log_request_timed_out(char* proc_name, char* op, char* resource_name);
 void log_request_ready(char* proc_name);
 void log_release_released(char* proc_name, char* resource_name);
 void log_release_error(char* proc_name, char* resource_name);
+void log_leaked_resource(char *proc_name, char *resource_name);
 void log_terminated(char *proc_name);
+void log_arrival(char *proc_name);
+void log_no_instruction();
+void log_priority_inherited(char *proc_name, int priority, char *waiter_name);
+void log_priority_restored(char *proc_name, int priority);
+void log_priority_ceiling(char *proc_name, int priority, char *resource_name);
+void log_job_release(char *proc_name, int job, long time);
+void log_deadline_miss(char *proc_name, int job, long deadline, long completed);
+void log_rt_summary(char *proc_name, int jobs, int misses, long max_lateness);
+void log_dispatch_summary(long dispatches, long blocked, long skipped);
+void log_stream_summary(long terminated, long time, long jobs, long misses, long max_lateness);
 void log_send(char *proc_name, char* msg, char* mailbox);
 void log_recv(char *proc_name, char* msg, char* mailbox);
 void log_deadlock_detected();
 void log_blocked_procs();
 
+void log_capture_begin(log_capture_t *buf);
+void log_capture_end();
+void log_capture_flush(log_capture_t *buf);
+
 #endif
@@ -14,37 +14,209 @@
 #include <stdlib.h>
 #include <string.h>
 #include "proc_structs.h"
+#include "pcb_pool.h"
 #include "proc_syntax.h"
 #include "logger.h"
 #include "manager.h"
+#include "partition.h"
+#include "time_warp.h"
+#include "pcb_heap.h"
+#include "ticket_tree.h"
+#include "rt_analysis.h"
+#include "lock_order.h"
+#include "explore.h"
 
 #define LOWEST_PRIORITY -1
 
+/* Fair scheduling: one tick of a priority 0 process adds CFS_TICK to its vruntime */
+#define CFS_TICK 1024UL
+#define CFS_NICE_0_WEIGHT 1024UL
+#define CFS_MAX_PRIORITY 19
+
+/* Proportional share: a process with one ticket adds STRIDE1 to its pass per tick */
+#define STRIDE1 (1UL << 20)
+#define LOTTERY_SEED 0x2545F4914F6CDD1DULL
+
+/* Periodic processes are simulated for one hyperperiod, at most RT_MAX_HORIZON ticks */
+#define RT_MAX_HORIZON 100000L
+
+/* Aging: a ready process gains one priority level per AGING_INTERVAL ticks of waiting */
+#ifndef AGING_INTERVAL
+#define AGING_INTERVAL 8L
+#endif
+
+/** Weight of each priority: every step up gets 25% more CPU time */
+static const unsigned long cfs_weights[CFS_MAX_PRIORITY + 1] = {
+    1024, 1280, 1600, 2000, 2500, 3125, 3906, 4883, 6104, 7629,
+    9537, 11921, 14901, 18626, 23283, 29104, 36380, 45475, 56843, 71054
+};
+
 int num_processes = 0;
 
 /**
- * The queues as required by the spec
+ * The queues as required by the spec. They are thread local so that
+ * independent simulations can run side by side on worker threads.
  */
-static pcb_queue_t terminatedq;
-static pcb_queue_t waitingq;
-static pcb_queue_t readyq;
-static bool_t readyq_updated;
+static SIM_LOCAL pcb_queue_t terminatedq;
+static SIM_LOCAL pcb_queue_t waitingq;
+static SIM_LOCAL pcb_queue_t readyq;
+static SIM_LOCAL pcb_queue_t arrivalq;
+static SIM_LOCAL bool_t readyq_updated;
 
-void schedule_fcfs();
-void schedule_rr(int quantum);
-void schedule_pri_w_pre();
+/**
+ * Schedulers that order the ready processes by a key keep them in a heap
+ * or a tree instead of readyq.
+ */
+static SIM_LOCAL pcb_heap_t readyh;
+static SIM_LOCAL rb_tree_t readyt;
+static SIM_LOCAL unsigned long ready_clock;
+
+/* The policy being run, its time quantum and when the running process was picked */
+static SIM_LOCAL const sched_policy_t *policy;
+static SIM_LOCAL int time_quantum;
+static SIM_LOCAL long dispatched_at;
+
+/* Fair scheduling state */
+static SIM_LOCAL unsigned long min_vruntime;
+static SIM_LOCAL unsigned long cfs_granularity;
+
+/* Proportional share state: the pass of the last process picked by stride
+   scheduling, and the lottery tickets of the ready processes */
+static SIM_LOCAL unsigned long global_pass;
+static SIM_LOCAL ticket_tree_t readyk;
+static SIM_LOCAL unsigned long long lottery_state;
+
+/* Simulated time: every executed instruction takes one tick */
+static SIM_LOCAL long sim_clock;
+
+/* Real-time state: the periodic processes waiting for their next release,
+   ordered by release time, and the time after which no job is released */
+static SIM_LOCAL pcb_heap_t releaseh;
+static SIM_LOCAL long rt_horizon;
+
+/* Set once before scheduling: holders of a resource inherit the priority of
+   its waiters, or run at its ceiling (the priority protocols) */
+static bool_t inherit_priority = FALSE;
+static bool_t ceiling_priority = FALSE;
+
+/* Effective priority of the running process in aging units, see aging_init */
+static SIM_LOCAL long aging_running_key;
+
+/* Set once before scheduling: only dispatch processes whose next request can be granted,
+   and hand a released resource straight to one waiter */
+static bool_t runnable_dispatch = FALSE;
+static bool_t handoff_release = FALSE;
+
+/* Set when nothing reads a terminated process after the run, so that its
+   pcb can go back to the pool as soon as it terminates */
+static bool_t recycle_terminated = FALSE;
+
+/* Set to fold the metrics of a terminated process into the totals below
+   and free it at once instead of keeping it on the terminatedq until the
+   end; only with recycle_terminated */
+static bool_t stream_metrics = FALSE;
+static SIM_LOCAL long total_terminated;
+static SIM_LOCAL long total_jobs;
+static SIM_LOCAL long total_misses;
+static SIM_LOCAL long worst_lateness;
+
+/* One bit per resource id, set while the resource is free, so that a
+   dispatch can test the next request of a process in O(1) */
+static SIM_LOCAL unsigned long *free_bits;
+static SIM_LOCAL int free_words;
+
+/* Processes waiting on a timed request, ordered by the time they give up */
+static SIM_LOCAL pcb_heap_t timerh;
+
+/* With priority inheritance, or handoff under a policy that orders by
+   priority, the processes blocked on each resource, by resource id, highest
+   priority first: the holder of a resource finds the priority it inherits
+   from it in O(1), and handoff the next waiter in O(log n) */
+static SIM_LOCAL pcb_heap_t *waiterh;
+
+/* With handoff under the other policies, the same waiters in the order they
+   started to wait */
+static SIM_LOCAL pcb_heap_t *waiterf;
+static SIM_LOCAL unsigned long wait_clock;
+
+/* Waiters that a handoff could not grant, until it blocks them again */
+static SIM_LOCAL pcb_t **set_aside;
+static SIM_LOCAL int set_aside_cap;
+
+/* Processes dispatched, dispatches that blocked on their first instruction,
+   and processes parked on the waitingq instead of being dispatched */
+static SIM_LOCAL long dispatches;
+static SIM_LOCAL long blocked_dispatches;
+static SIM_LOCAL long skipped_dispatches;
+
+bool_t higher_aged_priority(pcb_t *a, pcb_t *b);
 bool_t higher_priority(int, int);
+bool_t higher_priority_first(pcb_t *a, pcb_t *b);
+bool_t higher_priority_waiter(pcb_t *a, pcb_t *b);
+bool_t earlier_waiter(pcb_t *a, pcb_t *b);
+bool_t shorter_job(pcb_t *a, pcb_t *b);
+int less_vruntime(const rb_node_t *a, const rb_node_t *b);
+unsigned long cfs_weight(int priority);
+bool_t lower_pass(pcb_t *a, pcb_t *b);
+long get_tickets(pcb_t *pcb);
+unsigned long long lottery_rand();
+bool_t earlier_deadline(pcb_t *a, pcb_t *b);
+bool_t shorter_period(pcb_t *a, pcb_t *b);
+bool_t earlier_release(pcb_t *a, pcb_t *b);
+bool_t earlier_timeout(pcb_t *a, pcb_t *b);
+void start_job(pcb_t *pcb, long release);
+void complete_job(pcb_t *pcb);
+void release_due_jobs();
+long rt_hyperperiod();
+void print_rt_summary();
+bool_t readyq_empty();
+void advance_instr(pcb_t *pcb);
 
 void execute_instr(pcb_t *proc, instr_t *instr);
 void request_resource(pcb_t *proc, instr_t *instr);
 void release_resource(pcb_t *proc, instr_t *instr);
 bool_t acquire_resource(pcb_t *proc, char *resource_name);
+void take_resource(resource_t *resource, pcb_t *pcb);
+void grant_resource(resource_t *resource, pcb_t *pcb, instr_t *instr);
+void grant_request(pcb_t *pcb, instr_t *instr);
+void grant_waiter(pcb_t *pcb);
+bool_t request_grantable(instr_t *instr);
+bool_t resource_grantable(int id, bool_t shared);
+bool_t mode_compatible(resource_t *resource, bool_t shared);
+resource_t *intention_conflict(resource_t *ancestor, bool_t shared);
+void update_availability(resource_t *resource);
+bool_t hand_off_resource(resource_t *resource);
+bool_t drop_hold(resource_t *resource, bool_t shared);
+void wake_waiters_below(resource_t *resource);
+void count_waiting_writer(pcb_t *pcb, instr_t *instr, int delta);
+void block_on_resource(pcb_t *pcb, instr_t *instr);
+void skip_critical_section(pcb_t *pcb, instr_t *instr);
+bool_t requests_resource(instr_t *instr, char *resource_name);
+void expire_timed_requests();
+bool_t resource_free(int id);
+bool_t can_run(pcb_t *pcb);
+pcb_t *pick_runnable();
+
+void inherit_waiter_priority(pcb_t *waiter);
+void restore_priority(pcb_t *pcb);
+void set_priority(pcb_t *pcb, int priority);
+static void init_waiter_heaps(void);
+static pcb_heap_t *new_waiter_heaps(pcb_before_t before, size_t idx_offset);
+static void free_waiter_heaps(void);
+static void add_waiter(pcb_t *pcb);
+static void remove_waiter(pcb_t *pcb);
+static resource_t *request_conflict(instr_t *instr, resource_t **wanted);
+static int set_aside_waiter(pcb_t *pcb, int num_aside);
+static void block_again(pcb_t *pcb);
 
 bool_t check_for_new_arrivals();
-void move_proc_to_wq(pcb_t *pcb, char *resource_name);
+void wake_proc(pcb_t *pcb);
+void move_proc_to_wq(pcb_t *pcb, instr_t *instr, char *resource_name);
+void unlink_waiting(pcb_t *pcb);
 void move_waiting_pcbs_to_rq(char *resource_name);
 void move_proc_to_rq(pcb_t *pcb);
 void move_proc_to_tq(pcb_t *pcb);
+void release_held_resources(pcb_t *pcb);
 void enqueue_pcb(pcb_t *proc, pcb_queue_t *queue);
 pcb_t *dequeue_pcb(pcb_queue_t *queue);
 
@@ -52,6 +224,8 @@ char *get_init_data(int num_args, char **argv);
 char *get_data(int num_args, char **argv);
 int get_algo(int num_args, char **argv);
 int get_time_quantum(int num_args, char **argv);
+int get_options(int num_args, char **argv);
+int get_num_threads(int num_args, char **argv);
 void print_args(char *data1, char *data2, int sched, int tq);
 
 void print_avail_resources(void);
@@ -61,10 +235,8 @@ void print_running(pcb_t *proc, char *msg);
 void print_instructions(instr_t *instr);
 
 /* utility functions */
-void mark_resource_as_available(char *resource_name);
+void mark_resource_as_available(resource_t *resource);
 bool_t is_waiting_for_resource(pcb_t *pcb, char *resource_name);
-pcb_t *find_highest_priority_proc();
-void remove_proc_from_readyq(pcb_t *proc);
 void move_waiting_to_ready_based_on_resources();
 bool_t is_resource_available(const char *resource_name);
 bool_t is_resource_available_for_process(pcb_t *process);
@@ -72,6 +244,102 @@ bool_t check_deadlock();
 pcb_t *find_resource_holder(char *resource_name);
 pcb_t *find_holder_of_resource(char *resource_name);
 
+/* scheduling policies, see run_policy */
+static void restore_chain(resource_t *resource);
+static char *request_op(instr_t *instr);
+static void prior_init(void);
+static void heap_enqueue(pcb_t *pcb);
+static pcb_t *heap_pick_next(void);
+static bool_t prior_should_preempt(pcb_t *pcb);
+static void prior_on_priority(pcb_t *pcb, int old_priority);
+static void fcfs_enqueue(pcb_t *pcb);
+static pcb_t *fcfs_pick_next(void);
+static void sjf_init(void);
+static bool_t srtf_should_preempt(pcb_t *pcb);
+static void cfs_init(void);
+static void cfs_enqueue(pcb_t *pcb);
+static pcb_t *cfs_pick_next(void);
+static void cfs_on_wakeup(pcb_t *pcb);
+static void cfs_on_tick(pcb_t *pcb);
+static bool_t cfs_should_preempt(pcb_t *pcb);
+static void stride_init(void);
+static pcb_t *stride_pick_next(void);
+static void stride_on_wakeup(pcb_t *pcb);
+static void stride_on_tick(pcb_t *pcb);
+static bool_t quantum_expired(pcb_t *pcb);
+static void lottery_init(void);
+static void lottery_enqueue(pcb_t *pcb);
+static pcb_t *lottery_pick_next(void);
+static void lottery_on_priority(pcb_t *pcb, int old_priority);
+static void lottery_finish(void);
+static void edf_init(void);
+static void rm_init(void);
+static pcb_t *rt_pick_next(void);
+static void rt_on_tick(pcb_t *pcb);
+static bool_t rt_should_preempt(pcb_t *pcb);
+static bool_t rt_on_idle(void);
+static void aging_init(void);
+static void aging_enqueue(pcb_t *pcb);
+static pcb_t *aging_pick_next(void);
+static bool_t aging_should_preempt(pcb_t *pcb);
+static void aging_on_priority(pcb_t *pcb, int old_priority);
+
+static const sched_policy_t prior_policy = {
+    .init = prior_init, .enqueue = heap_enqueue, .pick_next = heap_pick_next,
+    .should_preempt = prior_should_preempt, .on_priority = prior_on_priority, .by_priority = TRUE
+};
+
+static const sched_policy_t fcfs_policy = {
+    .enqueue = fcfs_enqueue, .pick_next = fcfs_pick_next
+};
+
+static const sched_policy_t sjf_policy = {
+    .init = sjf_init, .enqueue = heap_enqueue, .pick_next = heap_pick_next
+};
+
+static const sched_policy_t srtf_policy = {
+    .init = sjf_init, .enqueue = heap_enqueue, .pick_next = heap_pick_next,
+    .should_preempt = srtf_should_preempt
+};
+
+static const sched_policy_t cfs_policy = {
+    .init = cfs_init, .enqueue = cfs_enqueue, .pick_next = cfs_pick_next,
+    .on_wakeup = cfs_on_wakeup, .on_tick = cfs_on_tick, .should_preempt = cfs_should_preempt
+};
+
+static const sched_policy_t stride_policy = {
+    .init = stride_init, .enqueue = heap_enqueue, .pick_next = stride_pick_next,
+    .on_wakeup = stride_on_wakeup, .on_tick = stride_on_tick, .should_preempt = quantum_expired
+};
+
+static const sched_policy_t lottery_policy = {
+    .init = lottery_init, .enqueue = lottery_enqueue, .pick_next = lottery_pick_next,
+    .should_preempt = quantum_expired, .on_priority = lottery_on_priority, .finish = lottery_finish
+};
+
+static const sched_policy_t edf_policy = {
+    .init = edf_init, .enqueue = heap_enqueue, .pick_next = rt_pick_next, .on_tick = rt_on_tick,
+    .should_preempt = rt_should_preempt, .on_complete = complete_job, .on_idle = rt_on_idle,
+    .finish = print_rt_summary
+};
+
+static const sched_policy_t rm_policy = {
+    .init = rm_init, .enqueue = heap_enqueue, .pick_next = rt_pick_next, .on_tick = rt_on_tick,
+    .should_preempt = rt_should_preempt, .on_complete = complete_job, .on_idle = rt_on_idle,
+    .finish = print_rt_summary
+};
+
+static const sched_policy_t aging_policy = {
+    .init = aging_init, .enqueue = aging_enqueue, .pick_next = aging_pick_next,
+    .should_preempt = aging_should_preempt, .on_priority = aging_on_priority, .by_priority = TRUE
+};
+
+/** The policy of every schedule_t; RR runs FCFS */
+static const sched_policy_t *const policies[] = {
+    &prior_policy, &fcfs_policy, &fcfs_policy, &sjf_policy, &srtf_policy, &cfs_policy,
+    &stride_policy, &lottery_policy, &edf_policy, &rm_policy, &aging_policy
+};
+
 /**
  * @brief Main function, initialises structures and variables
  *        starts process scheduling
@@ -82,9 +350,20 @@ int main(int argc, char **argv)
     char *data2 = get_data(argc, argv);
     int scheduler = get_algo(argc, argv);
     int time_quantum = get_time_quantum(argc, argv);
+    int options = get_options(argc, argv);
     print_args(data1, data2, scheduler, time_quantum);
+    inherit_priority = (options & OPT_INHERIT) ? TRUE : FALSE;
+    ceiling_priority = (options & OPT_CEILING) ? TRUE : FALSE;
+    runnable_dispatch = (options & OPT_RUNNABLE) ? TRUE : FALSE;
+    handoff_release = (options & OPT_HANDOFF) ? TRUE : FALSE;
+    if ((options & OPT_STREAM) && (options & (OPT_PARTITION | OPT_TIME_WARP))) {
+        /* Those runs read their terminated processes after the run */
+        printf("Option %s is ignored with %s and %s\n", OPT_STREAM_STR, OPT_PARTITION_STR, OPT_TIME_WARP_STR);
+        options &= ~OPT_STREAM;
+    }
 
     pcb_t *initial_procs = NULL;
+    pcb_t *arriving_procs = NULL;
     if (strcmp(data1, "generate") == 0) {
 #ifdef DEBUG_MNGR
         printf("****Generate processes and initialise the system\n");
@@ -100,11 +379,30 @@ int main(int argc, char **argv)
     /* schedule the processes */
     if (initial_procs)  {
         num_processes = get_num_procs();
-        init_queues(initial_procs);
+        /* The loader hands the arrival list over only once */
+        arriving_procs = get_arrival_pcbs();
+        if ((options & OPT_LOCK_ORDER) && check_lock_order(initial_procs, arriving_procs) > 0) {
+            printf("Workload rejected: its processes acquire resources in conflicting orders\n");
+        } else if (options & OPT_ANALYZE) {
+            analyze_task_set(initial_procs, arriving_procs);
+        } else if (options & OPT_EXPLORE) {
+            explore_interleavings(initial_procs, arriving_procs, get_num_threads(argc, argv));
+        } else if (options & OPT_TIME_WARP) {
+            schedule_time_warp(initial_procs, arriving_procs, scheduler,
+                               get_num_threads(argc, argv));
+        } else if (options & OPT_PARTITION) {
+            schedule_partitioned(initial_procs, arriving_procs, scheduler, time_quantum,
+                                 get_num_threads(argc, argv));
+        } else {
+            recycle_terminated = TRUE;
+            stream_metrics = (options & OPT_STREAM) ? TRUE : FALSE;
+            init_queues(initial_procs, arriving_procs);
 #ifdef DEBUG_MNGR
-        printf("****Scheduling processes*****\n");
+            printf("****Scheduling processes*****\n");
 #endif
-        schedule_processes(scheduler, time_quantum);
+            schedule_processes(scheduler, time_quantum);
+            free_manager();
+        }
         dealloc_data_structures();
     } else {
         printf("Error: no processes to schedule\n");
@@ -115,20 +413,36 @@ int main(int argc, char **argv)
 
 /**
  * @brief The linked list of loaded processes is moved to the readyqueue.
+ *        The processes still to arrive are kept in the arrival queue.
  *        The waiting and terminated queues are intialised to empty
  * @param cur_pcb: a pointer to the linked list of loaded processes
+ * @param arriving: a pointer to the linked list of processes arriving later
  */
-void init_queues(pcb_t *cur_pcb)
+void init_queues(pcb_t *cur_pcb, pcb_t *arriving)
 {
     readyq.first = cur_pcb;
-    for (cur_pcb = readyq.first; cur_pcb->next != NULL; cur_pcb = cur_pcb->next);
-    readyq.last = cur_pcb;
+    readyq.last = NULL;
+    for (; cur_pcb != NULL; cur_pcb = pcb_next(cur_pcb)) readyq.last = cur_pcb;
     readyq_updated = FALSE;
 
+    arrivalq.first = arriving;
+    arrivalq.last = NULL;
+    for (; arriving != NULL; arriving = pcb_next(arriving)) arrivalq.last = arriving;
+
     waitingq.last = NULL;
     waitingq.first = NULL;
     terminatedq.last = NULL;
     terminatedq.first = NULL;
+    total_terminated = total_jobs = total_misses = 0;
+    worst_lateness = LONG_MIN;
+
+    init_pcb_heap(&readyh, NULL);
+    rb_init(&readyt, NULL);
+    init_ticket_tree(&readyk);
+    policy = NULL;
+    ready_clock = 0;
+    sim_clock = 0;
+    init_pcb_heap(&releaseh, earlier_release);
 
 #ifdef DEBUG_MNGR
     printf("-----------------------------------");
@@ -149,152 +463,614 @@ void init_queues(pcb_t *cur_pcb)
  */
 void schedule_processes(schedule_t sched_type, int quantum)
 {
-    /* Uses FCFS and not RR scheduling - RR redirects to FCFS */
-    switch (sched_type) {
-    case PRIOR:
-        schedule_pri_w_pre();
-        break;
-    case RR:
-        /* schedule_rr(quantum); -> does not get called*/
-        schedule_fcfs();
-        break;
-    case FCFS:
-        schedule_fcfs();
-        break;
-    default:
-        break;
-    }
+    if ((int)sched_type < 0 || (size_t)sched_type >= sizeof(policies) / sizeof(policies[0])) return;
+    run_policy(policies[sched_type], quantum);
 }
 
 /**
- * Schedules processes using priority scheduling with preemption 
-*/
-void schedule_pri_w_pre()
+ * @brief The execution loop shared by all schedulers.
+ *
+ * The policy decides which ready process runs next and when it is
+ * preempted; the loop executes one instruction per tick, admits arrivals,
+ * parks processes that block, terminates the ones that ran out of
+ * instructions, and idles the clock while processes are still to arrive.
+ * The processes already in readyq are handed to the policy in queue order.
+ * With runnable dispatch, a process whose next request cannot be granted is
+ * parked on the waitingq when it is picked instead of being dispatched.
+ * Timed requests that waited long enough are given up before each tick.
+ *
+ * @param[in] p
+ *     scheduling policy
+ * @param[in] quantum
+ *     time quantum, for the policies that use one
+ */
+void run_policy(const sched_policy_t *p, int quantum)
 {
     pcb_t *current_process = NULL;
-    pcb_t *highest_priority_proc;
-
-    while (readyq.first != NULL || waitingq.first != NULL || current_process != NULL)  {
-        /* Attempt to select the highest-priority process if there's no current process */
-        if (!current_process) {
-            current_process = find_highest_priority_proc();
-            if (current_process)  {
-                remove_proc_from_readyq(current_process);
+    pcb_t *pcb, *next;
+    policy = p;
+    time_quantum = quantum > 0 ? quantum : 1;
+    dispatches = blocked_dispatches = skipped_dispatches = 0;
+
+    /* Every resource is free when a simulation starts */
+    free_words = (get_num_resources() + RESOURCE_BITS - 1) / RESOURCE_BITS;
+    free_bits = malloc((free_words ? free_words : 1) * sizeof(unsigned long));
+    if (free_bits == NULL) {
+        fprintf(stderr, "Memory allocation failed for resource bitmap\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(free_bits, 0xff, (free_words ? free_words : 1) * sizeof(unsigned long));
+    init_pcb_heap(&timerh, earlier_timeout);
+    init_waiter_heaps();
+    if (policy->init) policy->init();
+
+    pcb = readyq.first;
+    readyq.first = NULL;
+    readyq.last = NULL;
+    for (; pcb != NULL; pcb = next) {
+        next = pcb_next(pcb);
+        pcb_cold(pcb)->ready_seq = ready_clock++;
+        policy->enqueue(pcb);
+    }
+
+    for (;;) {
+        if (timerh.size > 0) expire_timed_requests();
+        if (current_process == NULL) {
+            current_process = pick_runnable();
+            if (current_process != NULL) {
                 current_process->state = RUNNING;
+                dispatched_at = sim_clock;
+                dispatches++;
             }
         }
 
-        /* Execute the next instruction if the current process is running */
-        if (current_process && current_process->state == RUNNING) {
-            execute_instr(current_process, current_process->next_instruction);
-
-            /* After executing an instruction, check for new arrivals */
-            bool_t new_arrival = check_for_new_arrivals();
-
-            if (current_process->next_instruction) {
-                /* don't increment the instruction if a process is returning from the waitq*/
-                if (current_process->state == RUNNING) {
-                    current_process->next_instruction = current_process->next_instruction->next;
+        if (current_process != NULL) {
+            if (current_process->next_instruction != NULL) {
+                execute_instr(current_process, current_process->next_instruction);
+                check_for_new_arrivals();
+                if (policy->on_tick) policy->on_tick(current_process);
+
+                /* A process that blocked is on the waitingq now */
+                if (current_process->state == WAITING) {
+                    if (sim_clock - dispatched_at == 1) blocked_dispatches++;
+                    if (policy->on_block) policy->on_block(current_process);
+                    current_process = NULL;
+                    continue;
                 }
-            }  else  {
-                // Process has no more instructions, move it to terminated queue
-                current_process->state = TERMINATED;
-                move_proc_to_tq(current_process);
-                current_process = NULL;
+                advance_instr(current_process);
             }
 
-            // If a new process has arrived, check if it should preempt the current process
-            if (new_arrival) {
-                highest_priority_proc = find_highest_priority_proc();
-                if (highest_priority_proc && (current_process == NULL 
-                    || higher_priority(highest_priority_proc->priority, current_process->priority))) {
-                    if (current_process)  {
-                        current_process->state = READY;
-                        move_proc_to_rq(current_process);
-                    }
-                    current_process = highest_priority_proc;
-                    remove_proc_from_readyq(current_process);
-                    current_process->state = RUNNING;
-                }
-            }
-
-            highest_priority_proc = find_highest_priority_proc();
-            if (highest_priority_proc && (current_process == NULL 
-                || higher_priority(highest_priority_proc->priority, current_process->priority))) {
-
-                if (current_process) {
-                    current_process->state = READY;
-                    move_proc_to_rq(current_process);
-                }
-                current_process = highest_priority_proc;
-                remove_proc_from_readyq(current_process);
-                current_process->state = RUNNING;
+            if (current_process->next_instruction == NULL) {
+                if (policy->on_complete) policy->on_complete(current_process);
+                else move_proc_to_tq(current_process);
+                current_process = NULL;
+            } else if (policy->should_preempt && policy->should_preempt(current_process)) {
+                move_proc_to_rq(current_process);
+                current_process = NULL;
             }
-        }  else if (current_process && current_process->state == WAITING) {
-            /* If the current process is waiting, check for a new process to run */
-            current_process = NULL;
+            continue;
         }
 
-        /* there are no processes left to schedule */
-        if (!current_process && readyq.first == NULL && waitingq.first == NULL && !check_for_new_arrivals()) {
-            break;
+        /* Nothing is ready: wait for the policy or the next arrival */
+        if (policy->on_idle && policy->on_idle()) continue;
+        if (arrivalq.first != NULL) {
+            sim_clock++;
+            check_for_new_arrivals();
+            continue;
         }
-
-        /* Check for deadlock when readyq is empty */
-        bool_t deadlock = check_deadlock();
-        if (deadlock)  {
-            break;
-            /* resolve_deadlock(current_process); */
+        /* Every process left is waiting, skip ahead to the first timeout */
+        if ((pcb = pcb_heap_peek(&timerh)) != NULL) {
+            if (pcb_cold(pcb)->wait_until > sim_clock) sim_clock = pcb_cold(pcb)->wait_until;
+            continue;
         }
+        check_deadlock();
+        break;
     }
+
+    if (policy->finish) policy->finish();
+    if (runnable_dispatch) log_dispatch_summary(dispatches, blocked_dispatches, skipped_dispatches);
+    if (stream_metrics) log_stream_summary(total_terminated, sim_clock, total_jobs, total_misses, worst_lateness);
+    policy = NULL;
+    free(free_bits);
+    free_bits = NULL;
+    free_pcb_heap(&timerh);
+    free_waiter_heaps();
 }
 
 /**
- * Schedules processes using FCFS scheduling
-*/
-void schedule_fcfs()
+ * @brief Gives every resource an empty heap of waiters by priority when
+ *        priorities are inherited or handoff follows them, and one in wait
+ *        order when handoff does not
+ */
+static void init_waiter_heaps(void)
 {
-    /* While there are processes in the ready queue */
-    while (readyq.first != NULL) {
-        pcb_t *current_process = dequeue_pcb(&readyq);
+    waiterh = waiterf = NULL;
+    wait_clock = 0;
+    if (inherit_priority || (handoff_release && policy->by_priority)) {
+        waiterh = new_waiter_heaps(higher_priority_waiter, offsetof(pcb_cold_t, wait_idx));
+    }
+    if (handoff_release && !policy->by_priority) waiterf = new_waiter_heaps(earlier_waiter, offsetof(pcb_cold_t, fifo_idx));
+}
 
-        if (current_process == NULL) {
-            break;
-        }
+/**
+ * @brief Returns an empty heap ordered by <code>before</code> for every
+ *        resource, by resource id
+ */
+static pcb_heap_t *new_waiter_heaps(pcb_before_t before, size_t idx_offset)
+{
+    int i, num = get_num_resources();
+    pcb_heap_t *heaps = malloc((num ? num : 1) * sizeof(pcb_heap_t));
 
-        current_process->state = RUNNING;
+    if (heaps == NULL) {
+        fprintf(stderr, "Memory allocation failed for waiter heaps\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < num; i++) init_pcb_heap_at(&heaps[i], before, idx_offset);
+    return heaps;
+}
 
-        /* Execute all instructions of the current process */
-        while (current_process->next_instruction != NULL)  {
-            execute_instr(current_process, current_process->next_instruction);
-            check_for_new_arrivals();
+/**
+ * @brief Frees the heaps of waiters
+ */
+static void free_waiter_heaps(void)
+{
+    int i;
 
-            /* If the process is waiting for a resource, break the execution loop */
-            if (current_process->state == WAITING)  {
-                move_proc_to_wq(current_process, current_process->next_instruction->resource_name);
-                break;
-            }
+    for (i = 0; i < get_num_resources(); i++) {
+        if (waiterh != NULL) free_pcb_heap(&waiterh[i]);
+        if (waiterf != NULL) free_pcb_heap(&waiterf[i]);
+    }
+    free(waiterh);
+    free(waiterf);
+    free(set_aside);
+    waiterh = waiterf = NULL;
+    set_aside = NULL;
+    set_aside_cap = 0;
+}
 
-            /* Move to the next instruction if not waiting */
-            current_process->next_instruction = current_process->next_instruction->next;
-        }
+/**
+ * @brief Adds a blocked process to the waiters of the resource it is
+ *        blocked on
+ */
+static void add_waiter(pcb_t *pcb)
+{
+    if (pcb_cold(pcb)->blocked_on == NULL) return;
+    if (waiterh != NULL) pcb_heap_push(&waiterh[pcb_cold(pcb)->blocked_on->id], pcb);
+    if (waiterf != NULL) pcb_heap_push(&waiterf[pcb_cold(pcb)->blocked_on->id], pcb);
+}
+
+/**
+ * @brief Takes a process off the waiters of the resource it is blocked on
+ */
+static void remove_waiter(pcb_t *pcb)
+{
+    if (pcb_cold(pcb)->blocked_on == NULL) return;
+    if (waiterh != NULL) pcb_heap_remove(&waiterh[pcb_cold(pcb)->blocked_on->id], pcb);
+    if (waiterf != NULL) pcb_heap_remove(&waiterf[pcb_cold(pcb)->blocked_on->id], pcb);
+}
+
+/**
+ * @brief Picks the next process of the policy. With runnable dispatch the
+ *        processes whose next request would block are parked on the
+ *        waitingq as if they had requested, and the next best is picked.
+ *
+ * @return The process to run, NULL if none is ready
+ */
+pcb_t *pick_runnable()
+{
+    pcb_t *pcb;
+
+    while ((pcb = policy->pick_next()) != NULL) {
+        if (!runnable_dispatch || can_run(pcb)) return pcb;
+        skipped_dispatches++;
+        block_on_resource(pcb, pcb->next_instruction);
+        if (policy->on_block) policy->on_block(pcb);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns TRUE unless the next instruction of <code>pcb</code>
+ *        requests a resource that is not free, in O(1)
+ */
+bool_t can_run(pcb_t *pcb)
+{
+    instr_t *instr = pcb->next_instruction;
 
-        /* If the process has completed all its instructions, move it to the terminated queue */
-        if (current_process->next_instruction == NULL && current_process->state != WAITING) {
-            move_proc_to_tq(current_process);
+    /* A tryreq never blocks */
+    if (instr == NULL || instr->type != REQ_OP || instr->timeout == 0) return TRUE;
+    return request_grantable(instr);
+}
+
+/**
+ * @brief Returns TRUE if every resource the instruction names is free: one
+ *        bit test, or one mask test per word of the bitmap for a request of
+ *        several resources
+ */
+bool_t request_grantable(instr_t *instr)
+{
+    resource_t *resource;
+    int w, i;
+
+    if (instr->set_size == 0) return resource_grantable(instr->resource_id, instr->shared);
+    if (instr->resource_id < 0) return FALSE;
+    if (!instr->shared) {
+        for (w = 0; w < free_words; w++) {
+            if (instr->set_mask[w] & ~free_bits[w]) return FALSE;
         }
     }
+    for (i = 0; i < instr->set_size; i++) {
+        resource = get_resource(instr->set_ids[i]);
+        if (instr->shared && !mode_compatible(resource, TRUE)) return FALSE;
+        if (intention_conflict(resource->parent, instr->shared) != NULL) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Returns TRUE if the resource with id <code>id</code> can be given
+ *        in shared or exclusive mode, and its ancestors in the hierarchy
+ *        allow the intention locks that come with it, in O(depth)
+ */
+bool_t resource_grantable(int id, bool_t shared)
+{
+    resource_t *resource = get_resource(id);
+
+    if (resource == NULL || !mode_compatible(resource, shared)) return FALSE;
+    return intention_conflict(resource->parent, shared) == NULL ? TRUE : FALSE;
+}
 
+/**
+ * @brief Returns TRUE if <code>resource</code> itself can be given in
+ *        exclusive mode (nobody holds it or any resource below it), or in
+ *        shared mode (no writer holds it, below it or waits for it, so that
+ *        readers cannot starve writers)
+ */
+bool_t mode_compatible(resource_t *resource, bool_t shared)
+{
+    if (!shared) return resource_free(resource->id);
+    return (resource->holder == NULL && resource->intent_exclusive == 0 && resource->writers_waiting == 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Returns the first of <code>ancestor</code> and the resources above
+ *        it that does not allow the intention lock of a request below it:
+ *        IS (shared) is kept out by a writer, IX (exclusive) by a writer or
+ *        readers. A writer waiting for an ancestor does not keep requests
+ *        below it out, or a process holding one of its children could never
+ *        get the next one.
+ *
+ * @return The conflicting ancestor, NULL if there is none
+ */
+resource_t *intention_conflict(resource_t *ancestor, bool_t shared)
+{
+    for (; ancestor != NULL; ancestor = ancestor->parent) {
+        if (ancestor->holder != NULL) return ancestor;
+        if (!shared && ancestor->readers > 0) return ancestor;
+    }
+    return NULL;
 }
 
 /**
- * Schedules processes using the Round-Robin scheduler.
+ * @brief Returns TRUE if the resource with id <code>id</code> is free
+ */
+bool_t resource_free(int id)
+{
+    if (id < 0) return FALSE;
+    return (free_bits[id / RESOURCE_BITS] >> (id % RESOURCE_BITS)) & 1UL ? TRUE : FALSE;
+}
+
+/* --- Priority scheduling with preemption ---------------------------------- */
+
+static void prior_init(void)
+{
+    init_pcb_heap(&readyh, higher_priority_first);
+}
+
+static void heap_enqueue(pcb_t *pcb)
+{
+    pcb_heap_push(&readyh, pcb);
+}
+
+static pcb_t *heap_pick_next(void)
+{
+    return pcb_heap_pop(&readyh);
+}
+
+/* Preempts when a ready process has a strictly higher priority */
+static bool_t prior_should_preempt(pcb_t *pcb)
+{
+    pcb_t *first = pcb_heap_peek(&readyh);
+
+    return (first && higher_priority(first->priority, pcb->priority)) ? TRUE : FALSE;
+}
+
+static void prior_on_priority(pcb_t *pcb, int old_priority)
+{
+    if (pcb_heap_contains(&readyh, pcb)) pcb_heap_update(&readyh, pcb);
+}
+
+/* --- First come first served ------------------------------------------------ */
+
+static void fcfs_enqueue(pcb_t *pcb)
+{
+    enqueue_pcb(pcb, &readyq);
+}
+
+static pcb_t *fcfs_pick_next(void)
+{
+    return dequeue_pcb(&readyq);
+}
+
+/* --- Shortest job first: a heap keyed by the instructions left -------------- */
+
+static void sjf_init(void)
+{
+    init_pcb_heap(&readyh, shorter_job);
+}
+
+/* SRTF: yields to a ready process with fewer instructions left */
+static bool_t srtf_should_preempt(pcb_t *pcb)
+{
+    pcb_t *shortest = pcb_heap_peek(&readyh);
+
+    return (shortest && pcb_cold(shortest)->remaining < pcb_cold(pcb)->remaining) ? TRUE : FALSE;
+}
+
+/*
+ * --- Completely fair scheduling ------------------------------------------------
+ * Every instruction adds CFS_TICK scaled down by the weight of the priority
+ * to the vruntime of a process, so higher priorities age more slowly and get
+ * a larger share of the CPU without starving anyone. The ready processes are
+ * kept in a red-black tree keyed by vruntime whose leftmost node is cached,
+ * and the running process is preempted once it is more than the quantum
+ * (in priority 0 ticks) ahead of the leftmost ready process.
+ */
+
+static void cfs_init(void)
+{
+    min_vruntime = 0;
+    cfs_granularity = (unsigned long)time_quantum * CFS_TICK;
+    rb_init(&readyt, less_vruntime);
+}
+
+static void cfs_enqueue(pcb_t *pcb)
+{
+    rb_insert(&readyt, &pcb_cold(pcb)->rb_node);
+}
+
+static pcb_t *cfs_pick_next(void)
+{
+    rb_node_t *node = rb_first(&readyt);
+
+    if (node == NULL) return NULL;
+    rb_erase(&readyt, node);
+    return pcb_at(rb_entry(node, pcb_cold_t, rb_node)->id);
+}
+
+/* A process that slept or just arrived keeps at most one granularity of credit */
+static void cfs_on_wakeup(pcb_t *pcb)
+{
+    if (pcb_cold(pcb)->vruntime + cfs_granularity < min_vruntime) pcb_cold(pcb)->vruntime = min_vruntime - cfs_granularity;
+}
+
+static void cfs_on_tick(pcb_t *pcb)
+{
+    rb_node_t *node = rb_first(&readyt);
+    pcb_cold_t *leftmost = node ? rb_entry(node, pcb_cold_t, rb_node) : NULL;
+    pcb_cold_t *cold = pcb_cold(pcb);
+
+    cold->vruntime += CFS_TICK * CFS_NICE_0_WEIGHT / cfs_weight(pcb->priority);
+
+    /* min_vruntime only moves forward */
+    if (cold->vruntime > min_vruntime && (!leftmost || cold->vruntime <= leftmost->vruntime)) {
+        min_vruntime = cold->vruntime;
+    } else if (leftmost && leftmost->vruntime > min_vruntime && leftmost->vruntime < cold->vruntime) {
+        min_vruntime = leftmost->vruntime;
+    }
+}
+
+static bool_t cfs_should_preempt(pcb_t *pcb)
+{
+    rb_node_t *node = rb_first(&readyt);
+
+    return (node && pcb_cold(pcb)->vruntime > rb_entry(node, pcb_cold_t, rb_node)->vruntime + cfs_granularity) ? TRUE : FALSE;
+}
+
+/*
+ * --- Proportional share ------------------------------------------------------
+ * Every process holds tickets (its priority + 1) and gets a share of the CPU
+ * proportional to them, one quantum at a time. Stride scheduling advances
+ * the pass of the running process by STRIDE1 / tickets per tick and runs the
+ * lowest pass next (an indexed heap). Lottery scheduling draws a random
+ * ticket from a Fenwick tree, so a draw is O(log n).
+ */
+
+static void stride_init(void)
+{
+    global_pass = 0;
+    init_pcb_heap(&readyh, lower_pass);
+}
+
+static pcb_t *stride_pick_next(void)
+{
+    pcb_t *pcb = pcb_heap_pop(&readyh);
+
+    if (pcb) global_pass = pcb_cold(pcb)->vruntime;
+    return pcb;
+}
+
+/* A process that slept does not get the ticks it missed */
+static void stride_on_wakeup(pcb_t *pcb)
+{
+    if (pcb_cold(pcb)->vruntime < global_pass) pcb_cold(pcb)->vruntime = global_pass;
+}
+
+static void stride_on_tick(pcb_t *pcb)
+{
+    pcb_cold(pcb)->vruntime += STRIDE1 / get_tickets(pcb);
+}
+
+static bool_t quantum_expired(pcb_t *pcb)
+{
+    return sim_clock - dispatched_at >= time_quantum ? TRUE : FALSE;
+}
+
+static void lottery_init(void)
+{
+    lottery_state = LOTTERY_SEED;
+    init_ticket_tree(&readyk);
+}
+
+static void lottery_enqueue(pcb_t *pcb)
+{
+    ticket_tree_add(&readyk, pcb, get_tickets(pcb));
+}
+
+static pcb_t *lottery_pick_next(void)
+{
+    pcb_t *pcb;
+
+    if (readyk.total <= 0) return NULL;
+    pcb = ticket_tree_find(&readyk, (long)(lottery_rand() % (unsigned long long)readyk.total));
+    ticket_tree_remove(&readyk, pcb);
+    return pcb;
+}
+
+/* The tickets of a ready process follow its priority */
+static void lottery_on_priority(pcb_t *pcb, int old_priority)
+{
+    int slot = pcb_mem(pcb)->number;
+
+    if (slot < readyk.size && readyk.slots[slot] == pcb) {
+        ticket_tree_remove(&readyk, pcb);
+        ticket_tree_add(&readyk, pcb, get_tickets(pcb));
+    }
+}
+
+static void lottery_finish(void)
+{
+    free_ticket_tree(&readyk);
+}
+
+/*
+ * --- Real-time scheduling ------------------------------------------------------
+ * Each run through the instructions of a process is a job; a periodic process
+ * releases a new job every period until the hyperperiod of the task set has
+ * passed. The ready processes are kept in the indexed heap keyed by absolute
+ * deadline (EDF) or period (RM), and the processes waiting for their next
+ * release in a second heap keyed by release time. Processes without a
+ * deadline (EDF) or a period (RM) run once, when no other job is ready.
+ * Deadline misses are logged as they happen, followed by a summary of the
+ * jobs, misses and lateness of every process with a deadline.
+ */
+
+static void rt_start(pcb_before_t before)
+{
+    pcb_t *pcb;
+
+    rt_horizon = rt_hyperperiod();
+    for (pcb = readyq.first; pcb != NULL; pcb = pcb_next(pcb)) start_job(pcb, sim_clock);
+    init_pcb_heap(&readyh, before);
+}
+
+static void edf_init(void)
+{
+    rt_start(earlier_deadline);
+}
+
+static void rm_init(void)
+{
+    rt_start(shorter_period);
+}
+
+static pcb_t *rt_pick_next(void)
+{
+    release_due_jobs();
+    return pcb_heap_pop(&readyh);
+}
+
+static void rt_on_tick(pcb_t *pcb)
+{
+    release_due_jobs();
+}
+
+static bool_t rt_should_preempt(pcb_t *pcb)
+{
+    pcb_t *first = pcb_heap_peek(&readyh);
+
+    return (first && readyh.before(first, pcb)) ? TRUE : FALSE;
+}
+
+/* Idles until the next release, or lets the loop step to an earlier arrival */
+static bool_t rt_on_idle(void)
+{
+    pcb_t *next = pcb_heap_peek(&releaseh);
+
+    if (next == NULL) return FALSE;
+    if (pcb_cold(next)->release > sim_clock) {
+        if (arrivalq.first != NULL) return FALSE;
+        sim_clock = pcb_cold(next)->release;
+    }
+    release_due_jobs();
+    return TRUE;
+}
+
+/*
+ * --- Priority scheduling with aging ----------------------------------------------
+ * The effective priority of a ready process rises by one level for every
+ * AGING_INTERVAL ticks it waits, so every process eventually runs.
  *
- * @param[in] quantum time quantum
+ * Aging costs nothing per tick. The effective priority at time t is
+ * (age_key + t) / AGING_INTERVAL, where age_key = priority * AGING_INTERVAL
+ * minus the time the process became ready. Every waiting process ages at the
+ * same rate, so their order by age_key never changes and a max-heap on the
+ * fixed age_key always has the oldest highest priority process on top. The
+ * running process keeps the effective priority it was dispatched with and is
+ * preempted once the top of the heap has aged past it.
  */
-void schedule_rr(int quantum)
+
+static void aging_init(void)
 {
-    /* RR option not chosen, FCFS has been implemented above */
+    init_pcb_heap(&readyh, higher_aged_priority);
+}
+
+static void aging_enqueue(pcb_t *pcb)
+{
+    pcb_cold(pcb)->age_key = pcb->priority * AGING_INTERVAL - sim_clock;
+    pcb_heap_push(&readyh, pcb);
+}
+
+static pcb_t *aging_pick_next(void)
+{
+    pcb_t *pcb = pcb_heap_pop(&readyh);
+
+    if (pcb) aging_running_key = pcb_cold(pcb)->age_key + sim_clock;
+    return pcb;
+}
+
+static bool_t aging_should_preempt(pcb_t *pcb)
+{
+    pcb_t *first = pcb_heap_peek(&readyh);
+
+    /* A process running at a resource ceiling is only preempted by a higher
+       priority, however long the others waited */
+    return (first && pcb_cold(first)->age_key + sim_clock > aging_running_key
+            && !(ceiling_priority && pcb->priority > pcb_cold(pcb)->base_priority
+                 && !higher_priority(first->priority, pcb->priority))) ? TRUE : FALSE;
+}
+
+/* A priority change moves the effective priority by whole levels */
+static void aging_on_priority(pcb_t *pcb, int old_priority)
+{
+    long delta = (long)(pcb->priority - old_priority) * AGING_INTERVAL;
+
+    if (pcb_heap_contains(&readyh, pcb)) {
+        pcb_cold(pcb)->age_key += delta;
+        pcb_heap_update(&readyh, pcb);
+    } else if (pcb->state == RUNNING) {
+        aging_running_key += delta;
+    }
 }
 
 /**
@@ -307,6 +1083,7 @@ void schedule_rr(int quantum)
  */
 void execute_instr(pcb_t *pcb, instr_t *instr)
 {
+    sim_clock++;
     if (instr != NULL) {
         switch (instr->type) {
         case REQ_OP:
@@ -314,14 +1091,15 @@ void execute_instr(pcb_t *pcb, instr_t *instr)
             break;
         case REL_OP:
             release_resource(pcb, instr);
-            /* After releasing a resource, check if any waiting processes can be moved to the ready queue */
-            move_waiting_to_ready_based_on_resources();
+            /* After releasing a resource, check if any waiting processes can be moved to the
+               ready queue; with handoff the waiters of the resource already got it */
+            if (!handoff_release) move_waiting_to_ready_based_on_resources();
             break;
         default:
             break;
         }
     } else {
-        printf("Error: No instruction to execute\n");
+        log_no_instruction();
     }
 
 #ifdef DEBUG_MNGR
@@ -340,46 +1118,324 @@ void execute_instr(pcb_t *pcb, instr_t *instr)
 /**
  * @brief Handles the request resource instruction.
  *
- * Executes the request instruction for the process. The function loops
- * through the list of resources and acquires the resource if it is available.
- * If the resource is not available the process is moved to the waiting queue
+ * Executes the request instruction for the process. The resource is found
+ * by the id the loader gave the instruction and acquired if it is available.
+ * A request of several resources acquires all of them or none.
+ * If a resource is not available the process is moved to the waiting queue,
+ * unless it is a tryreq: then the request fails and its critical section
+ * is skipped.
  *
  * @param current The current process for which the resource must be acquired.
  * @param instruct The request instruction
  */
 void request_resource(pcb_t *cur_pcb, instr_t *instr)
 {
-    resource_t *resource = get_available_resources();
-    bool_t found = FALSE;
+    if (!request_grantable(instr) && instr->timeout == 0) {
+        log_request_failed(pcb_mem(cur_pcb)->name, instr->resource_name);
+        skip_critical_section(cur_pcb, instr);
+        return;
+    }
+    if (!request_grantable(instr)) {
+        /* Move process to waiting queue if resource is not found or unavailable */
+        block_on_resource(cur_pcb, instr);
+        return;
+    }
+    grant_request(cur_pcb, instr);
+}
 
-    while (resource != NULL) {
-        if (strcmp(resource->name, instr->resource_name) == 0) {
-            if (resource->available == YES) {
-                found = TRUE;
-                resource->available = NO; /* Mark as unavailable */
-
-                /* Add resource to process's list of resources */
-                resource_t *new_resource = (resource_t *)malloc(sizeof(resource_t));
-                if (new_resource == NULL) {
-                    fprintf(stderr, "Memory allocation failed for new resource\n");
-                    exit(EXIT_FAILURE);
-                }
+/**
+ * @brief Skips the critical section of a request that was not granted, up
+ *        to the release of every resource it names. A request that is never
+ *        released skips nothing but itself.
+ *
+ * The process is left on the last skipped instruction, which it moves past
+ * like an instruction it executed.
+ */
+void skip_critical_section(pcb_t *pcb, instr_t *instr)
+{
+    instr_t *cur;
+    int open = instr->set_size ? instr->set_size : 1;
+    int skipped = 0;
+
+    for (cur = instr->next; cur != NULL; cur = cur->next) {
+        skipped++;
+        if (cur->type == REL_OP && requests_resource(instr, cur->resource_name) && --open == 0) {
+            pcb->next_instruction = cur;
+            pcb_cold(pcb)->remaining -= skipped;
+            return;
+        }
+    }
+}
 
-                *new_resource = *resource; /* copy resource data */
-                new_resource->next = cur_pcb->resources;
-                cur_pcb->resources = new_resource;
+/**
+ * @brief Returns TRUE if the request <code>instr</code> names resource
+ *        <code>resource_name</code>
+ */
+bool_t requests_resource(instr_t *instr, char *resource_name)
+{
+    int i;
 
-                log_request_acquired(cur_pcb->process_in_mem->name, instr->resource_name);
-                break;
-            }
+    if (instr->set_size == 0) return strcmp(instr->resource_name, resource_name) == 0 ? TRUE : FALSE;
+    for (i = 0; i < instr->set_size; i++) {
+        if (strcmp(instr->set_names[i], resource_name) == 0) return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Gives every resource of the request <code>instr</code>, which are
+ *        all free, to <code>pcb</code>
+ */
+void grant_request(pcb_t *pcb, instr_t *instr)
+{
+    int i;
+
+    if (pcb_cold(pcb)->writer_waiting) count_waiting_writer(pcb, instr, -1);
+    if (instr->set_size == 0) {
+        grant_resource(get_resource(instr->resource_id), pcb, instr);
+        return;
+    }
+    for (i = 0; i < instr->set_size; i++) grant_resource(get_resource(instr->set_ids[i]), pcb, instr);
+}
+
+/**
+ * @brief Gives a resource to <code>pcb</code> for request <code>instr</code>,
+ *        in shared mode as one of its readers, or else exclusively, with the
+ *        matching intention lock on the resources above it
+ */
+void grant_resource(resource_t *resource, pcb_t *cur_pcb, instr_t *instr)
+{
+    bool_t shared = instr->shared;
+    resource_t *ancestor;
+
+    if (shared) {
+        resource->readers++;
+        update_availability(resource);
+    } else {
+        take_resource(resource, cur_pcb);
+    }
+    /* Take the intention lock on every ancestor */
+    for (ancestor = resource->parent; ancestor != NULL; ancestor = ancestor->parent) {
+        if (shared) ancestor->intent_shared++;
+        else ancestor->intent_exclusive++;
+        update_availability(ancestor);
+    }
+
+    /* Add resource to process's list of resources */
+    resource_t *new_resource = (resource_t *)malloc(sizeof(resource_t));
+    if (new_resource == NULL) {
+        fprintf(stderr, "Memory allocation failed for new resource\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *new_resource = *resource; /* copy resource data */
+    new_resource->shared = shared;
+    new_resource->next = pcb_cold(cur_pcb)->resources;
+    pcb_cold(cur_pcb)->resources = new_resource;
+
+    log_request_acquired(pcb_mem(cur_pcb)->name, request_op(instr), resource->name);
+    if (ceiling_priority && higher_priority(resource->ceiling, cur_pcb->priority)) {
+        set_priority(cur_pcb, resource->ceiling);
+        log_priority_ceiling(pcb_mem(cur_pcb)->name, resource->ceiling, resource->name);
+    }
+}
+
+/**
+ * @brief Marks a resource as held by <code>pcb</code>
+ */
+void take_resource(resource_t *resource, pcb_t *pcb)
+{
+    resource->available = NO;
+    resource->holder = pcb;
+    free_bits[resource->id / RESOURCE_BITS] &= ~(1UL << (resource->id % RESOURCE_BITS));
+}
+
+/**
+ * @brief Moves a process whose request <code>instr</code> cannot be granted
+ *        to the waiting queue, and passes its priority on to the holder.
+ *        The process is blocked on the resource that conflicts, see
+ *        request_conflict. An exclusive request keeps new readers of its
+ *        resources out until it is granted or given up.
+ */
+void block_on_resource(pcb_t *pcb, instr_t *instr)
+{
+    resource_t *wanted;
+
+    pcb_cold(pcb)->blocked_on = request_conflict(instr, &wanted);
+    pcb_cold(pcb)->wait_seq = wait_clock++;
+    add_waiter(pcb);
+    if (!instr->shared && !pcb_cold(pcb)->writer_waiting) count_waiting_writer(pcb, instr, 1);
+    move_proc_to_wq(pcb, instr, wanted ? wanted->name : instr->resource_name);
+    if (instr->timeout > 0) {
+        pcb_cold(pcb)->wait_until = sim_clock + instr->timeout;
+        pcb_heap_push(&timerh, pcb);
+    }
+    if (inherit_priority) inherit_waiter_priority(pcb);
+}
+
+/**
+ * @brief Returns the resource that keeps request <code>instr</code> from
+ *        being granted. A request of several resources waits for the first
+ *        one held; the resource that conflicts is an ancestor if only its
+ *        intention lock cannot be taken. Without a conflict it is the first
+ *        resource of the request.
+ *
+ * @param[out] wanted
+ *     the resource of the request that waits, NULL if none conflicts
+ */
+static resource_t *request_conflict(instr_t *instr, resource_t **wanted)
+{
+    resource_t *resource, *conflict;
+    int i;
+
+    *wanted = NULL;
+    for (i = 0; i < (instr->set_size ? instr->set_size : 1); i++) {
+        resource = get_resource(instr->set_size ? instr->set_ids[i] : instr->resource_id);
+        if (resource == NULL) continue;
+        if (!mode_compatible(resource, instr->shared)) conflict = resource;
+        else conflict = intention_conflict(resource->parent, instr->shared);
+        if (conflict != NULL) {
+            *wanted = resource;
+            return conflict;
         }
-        resource = resource->next;
     }
+    return get_resource(instr->resource_id);
+}
 
-    if (!found) {
-        /* Move process to waiting queue if resource is not found or unavailable */
-        move_proc_to_wq(cur_pcb, instr->resource_name);
+/**
+ * @brief Gives up the timed requests that have waited long enough. Each
+ *        process leaves the waitingq in O(1), skips the critical section of
+ *        its request and becomes ready; the holders it passed its priority
+ *        on to drop it.
+ */
+void expire_timed_requests()
+{
+    pcb_t *pcb;
+    resource_t *resource;
+    bool_t writers_gave_up = FALSE;
+
+    while ((pcb = pcb_heap_peek(&timerh)) != NULL && pcb_cold(pcb)->wait_until <= sim_clock) {
+        unlink_waiting(pcb);
+        resource = pcb_cold(pcb)->blocked_on;
+        pcb_cold(pcb)->blocked_on = NULL;
+        log_request_timed_out(pcb_mem(pcb)->name, request_op(pcb->next_instruction),
+                              resource ? resource->name : pcb->next_instruction->resource_name);
+        if (inherit_priority) restore_chain(resource);
+        if (pcb_cold(pcb)->writer_waiting) {
+            /* The readers it held back may go now */
+            count_waiting_writer(pcb, pcb->next_instruction, -1);
+            writers_gave_up = TRUE;
+        }
+        skip_critical_section(pcb, pcb->next_instruction);
+        advance_instr(pcb);
+        wake_proc(pcb);
+    }
+    if (writers_gave_up) move_waiting_to_ready_based_on_resources();
+}
+
+/**
+ * @brief Adds <code>delta</code> to the waiting writers of every resource of
+ *        the exclusive request <code>instr</code> of <code>pcb</code>: 1 when
+ *        it starts to wait, -1 when it is granted or given up
+ */
+void count_waiting_writer(pcb_t *pcb, instr_t *instr, int delta)
+{
+    resource_t *resource;
+    int i;
+
+    for (i = 0; i < (instr->set_size ? instr->set_size : 1); i++) {
+        resource = get_resource(instr->set_size ? instr->set_ids[i] : instr->resource_id);
+        if (resource != NULL) resource->writers_waiting += delta;
     }
+    pcb_cold(pcb)->writer_waiting = delta > 0 ? TRUE : FALSE;
+}
+
+/**
+ * @brief Passes the priority of a process that just blocked on to the holder
+ *        of the resource it waits for, and on along the chain of holders
+ *        that are themselves blocked.
+ *
+ * Every resource knows its holder and every blocked process the resource it
+ * waits for, so each step of the chain is O(1). The walk stops at a holder
+ * that already has at least the priority, and after num_processes steps in
+ * case the chain is a deadlock cycle.
+ *
+ * @param[in] waiter
+ *     process that just blocked
+ */
+void inherit_waiter_priority(pcb_t *waiter)
+{
+    resource_t *resource = pcb_cold(waiter)->blocked_on;
+    pcb_t *holder;
+    int steps = 0;
+
+    while (resource != NULL && (holder = resource->holder) != NULL
+           && holder != waiter && steps++ < num_processes) {
+        if (!higher_priority(waiter->priority, holder->priority)) break;
+        log_priority_inherited(pcb_mem(holder)->name, waiter->priority, pcb_mem(waiter)->name);
+        set_priority(holder, waiter->priority);
+        resource = pcb_cold(holder)->blocked_on;
+    }
+}
+
+/**
+ * @brief Drops the priority that a waiter that gave up passed on to the
+ *        holder of <code>resource</code>, and on along the chain of holders
+ *        that are themselves blocked, as inherit_waiter_priority passed it.
+ *        The walk stops at a holder whose priority does not change, and
+ *        after num_processes steps in case the chain is a deadlock cycle.
+ */
+static void restore_chain(resource_t *resource)
+{
+    pcb_t *holder;
+    int old_priority, steps = 0;
+
+    while (resource != NULL && (holder = resource->holder) != NULL && steps++ < num_processes) {
+        old_priority = holder->priority;
+        restore_priority(holder);
+        if (holder->priority == old_priority) break;
+        resource = pcb_cold(holder)->blocked_on;
+    }
+}
+
+/**
+ * @brief Drops the inherited priority of a process that released a resource
+ *        to the highest ceiling of the resources it still holds (ceiling
+ *        protocol), the highest priority still waiting for one of them
+ *        (inheritance), or else to its base priority.
+ *
+ * The waiters of each resource are kept in a heap, so this is O(1) per
+ * resource held rather than a scan of the waitingq.
+ */
+void restore_priority(pcb_t *pcb)
+{
+    resource_t *held, *resource;
+    pcb_t *waiter;
+    int priority = pcb_cold(pcb)->base_priority;
+
+    for (held = pcb_cold(pcb)->resources; held != NULL; held = held->next) {
+        if (ceiling_priority && higher_priority(held->ceiling, priority)) priority = held->ceiling;
+        if (!inherit_priority || (resource = get_resource(held->id)) == NULL || resource->holder != pcb) continue;
+        waiter = pcb_heap_peek(&waiterh[resource->id]);
+        if (waiter != NULL && higher_priority(waiter->priority, priority)) priority = waiter->priority;
+    }
+    if (priority != pcb->priority) {
+        set_priority(pcb, priority);
+        log_priority_restored(pcb_mem(pcb)->name, priority);
+    }
+}
+
+/**
+ * @brief Changes the priority of a process and lets the policy reorder its
+ *        ready store, or the waiters of its resource if it is blocked
+ */
+void set_priority(pcb_t *pcb, int priority)
+{
+    int old_priority = pcb->priority;
+
+    pcb->priority = priority;
+    if (waiterh != NULL && pcb_cold(pcb)->blocked_on != NULL) pcb_heap_update(&waiterh[pcb_cold(pcb)->blocked_on->id], pcb);
+    if (policy != NULL && policy->on_priority != NULL) policy->on_priority(pcb, old_priority);
 }
 
 /**
@@ -401,7 +1457,7 @@ bool_t acquire_resource(pcb_t *cur_pcb, char *resource_name)
     while (resource != NULL)  {
         if (strcmp(resource->name, resource_name) == 0 && resource->available == YES) {
             /* Mark the resource as unavailable */
-            resource->available = NO;
+            take_resource(resource, cur_pcb);
 
             /* Create a new resource node for the process's resources list */
             resource_t *new_resource = (resource_t *)malloc(sizeof(resource_t));
@@ -412,58 +1468,210 @@ bool_t acquire_resource(pcb_t *cur_pcb, char *resource_name)
 
             /* Copy the resource details */
             *new_resource = *resource;
-            new_resource->next = cur_pcb->resources;
-            cur_pcb->resources = new_resource;
+            new_resource->next = pcb_cold(cur_pcb)->resources;
+            pcb_cold(cur_pcb)->resources = new_resource;
+
+            return TRUE; /* Resource successfully acquired */
+        }
+        resource = resource->next;
+    }
+
+    return FALSE; /* Resource not found or not available */
+}
+
+/**
+ * @brief Handles the release resource instruction.
+ *
+ * Executes the release instruction for the process. If the resource can be
+ * released the process is ready for next execution. If the resource can not
+ * be released the process waits
+ *
+ * @param current The process which releases the resource.
+ * @param instruct The instruction to release the resource.
+ */
+void release_resource(pcb_t *pcb, instr_t *instr)
+{
+    resource_t *prev = NULL;
+    resource_t *cur = pcb_cold(pcb)->resources;
+    bool_t found = FALSE, freed = FALSE;
+
+    while (cur != NULL) {
+        if (cur->id == instr->resource_id) {
+            found = TRUE;
+            if (prev != NULL) {
+                prev->next = cur->next;
+            } else {
+                pcb_cold(pcb)->resources = cur->next;
+            }
+
+            log_release_released(pcb_mem(pcb)->name, instr->resource_name);
+
+            freed = drop_hold(get_resource(cur->id), cur->shared);
+            free(cur); /* Free the resource node */
+            if (inherit_priority || ceiling_priority) restore_priority(pcb);
+            break;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+
+    if (!found) {
+        log_release_error(pcb_mem(pcb)->name, instr->resource_name);
+    } else if (freed && !handoff_release) {
+        /* Check waiting queue for processes waiting for this resource */
+        move_waiting_pcbs_to_rq(instr->resource_name);
+    }
+}
+
+/**
+ * @brief Transfers a resource that is being released to one of its waiters
+ *        and moves only that process to the ready queue, instead of waking
+ *        every waiter to race for it.
+ *
+ * The resource has just been marked as available. The waiter is taken from
+ * the waiters of the resource: the first one to wait, or the highest
+ * priority one if the policy orders by priority. Its request is granted on
+ * the spot. A waiter that cannot be granted, e.g. because another resource
+ * of its set is held, is set aside and then blocked again on the resource
+ * that holds it up, so that the handoff of that one finds it. If the
+ * waiter is a reader, or wants a resource below this one, every other
+ * waiter that can still be granted gets its request too. With priority
+ * inheritance the waiter inherits the priority of the waiters it now
+ * blocks.
+ *
+ * @return TRUE if the resource was handed over, FALSE if nobody can take it
+ */
+bool_t hand_off_resource(resource_t *resource)
+{
+    pcb_heap_t *waiters = waiterf != NULL ? &waiterf[resource->id] : &waiterh[resource->id];
+    pcb_t *pcb, *chosen, *top_other;
+    instr_t *instr;
+    int num_aside = 0;
+
+    while ((chosen = pcb_heap_peek(waiters)) != NULL && !request_grantable(chosen->next_instruction)) {
+        num_aside = set_aside_waiter(chosen, num_aside);
+    }
+    if (chosen != NULL) {
+        instr = chosen->next_instruction;
+        grant_waiter(chosen);
+        top_other = inherit_priority ? pcb_heap_peek(&waiterh[resource->id]) : NULL;
+        if (top_other && higher_priority(top_other->priority, chosen->priority)) {
+            log_priority_inherited(pcb_mem(chosen)->name, top_other->priority, pcb_mem(top_other)->name);
+            set_priority(chosen, top_other->priority);
+        }
+        wake_proc(chosen);
+
+        /* Readers, and requests below it in the hierarchy, share the resource:
+           the others that can still be granted go along */
+        while ((instr->shared || resource->intent_shared || resource->intent_exclusive)
+               && (pcb = pcb_heap_peek(waiters)) != NULL) {
+            if (!request_grantable(pcb->next_instruction)) {
+                num_aside = set_aside_waiter(pcb, num_aside);
+                continue;
+            }
+            grant_waiter(pcb);
+            wake_proc(pcb);
+        }
+    }
+    while (num_aside > 0) block_again(set_aside[--num_aside]);
+    return chosen != NULL ? TRUE : FALSE;
+}
+
+/**
+ * @brief Takes a waiter that a handoff cannot grant off the waiters of its
+ *        resource until the handoff is done
+ *
+ * @return The number of waiters set aside
+ */
+static int set_aside_waiter(pcb_t *pcb, int num_aside)
+{
+    pcb_t **grown;
+
+    if (num_aside == set_aside_cap) {
+        set_aside_cap = set_aside_cap ? 2 * set_aside_cap : 16;
+        grown = realloc(set_aside, set_aside_cap * sizeof(pcb_t *));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for set aside waiters\n");
+            exit(EXIT_FAILURE);
+        }
+        set_aside = grown;
+    }
+    remove_waiter(pcb);
+    set_aside[num_aside] = pcb;
+    return num_aside + 1;
+}
+
+/**
+ * @brief Blocks a waiter that a handoff set aside again, on the resource
+ *        that holds its request up now. If that is another resource, its
+ *        holder inherits the priority of the waiter.
+ */
+static void block_again(pcb_t *pcb)
+{
+    resource_t *was_on = pcb_cold(pcb)->blocked_on, *wanted;
 
-            return TRUE; /* Resource successfully acquired */
-        }
-        resource = resource->next;
-    }
+    pcb_cold(pcb)->blocked_on = request_conflict(pcb->next_instruction, &wanted);
+    add_waiter(pcb);
+    if (inherit_priority && pcb_cold(pcb)->blocked_on != was_on) inherit_waiter_priority(pcb);
+}
 
-    return FALSE; /* Resource not found or not available */
+/**
+ * @brief Takes a waiting process off the waitingq and grants its request
+ */
+void grant_waiter(pcb_t *pcb)
+{
+    unlink_waiting(pcb);
+    grant_request(pcb, pcb->next_instruction);
+    advance_instr(pcb);
 }
 
 /**
- * @brief Handles the release resource instruction.
- *
- * Executes the release instruction for the process. If the resource can be
- * released the process is ready for next execution. If the resource can not
- * be released the process waits
+ * @brief Gives up one hold on a resource and the intention locks that came
+ *        with it. A reader just leaves; the last reader or the writer frees
+ *        the resource, and hands it to its waiters with handoff, as well as
+ *        each ancestor that no longer has a writer below it.
  *
- * @param current The process which releases the resource.
- * @param instruct The instruction to release the resource.
+ * @return TRUE if the resource is no longer held and, without handoff, its
+ *         waiters must be woken
  */
-void release_resource(pcb_t *pcb, instr_t *instr)
+bool_t drop_hold(resource_t *resource, bool_t shared)
 {
-    resource_t *prev = NULL;
-    resource_t *cur = pcb->resources;
-    bool_t found = FALSE;
-
-    while (cur != NULL) {
-        if (strcmp(cur->name, instr->resource_name) == 0) {
-            found = TRUE;
-            if (prev != NULL) {
-                prev->next = cur->next;
-            } else {
-                pcb->resources = cur->next;
-            }
+    resource_t *ancestor;
+    bool_t freed;
+
+    if (shared) resource->readers--;
+    else resource->holder = NULL;
+    freed = (resource->holder == NULL && resource->readers == 0) ? TRUE : FALSE;
+    update_availability(resource);
+    if (freed && handoff_release) hand_off_resource(resource);
+    else if (freed) wake_waiters_below(resource);
+
+    for (ancestor = resource->parent; ancestor != NULL; ancestor = ancestor->parent) {
+        if (shared && --ancestor->intent_shared > 0) continue;
+        if (!shared && --ancestor->intent_exclusive > 0) continue;
+        update_availability(ancestor);
+        /* The last intention lock of its mode is gone: waiters for the ancestor itself may go on */
+        if (ancestor->holder != NULL || ancestor->intent_exclusive > 0) continue;
+        if (handoff_release) hand_off_resource(ancestor);
+        else move_waiting_pcbs_to_rq(ancestor->name);
+    }
+    return freed;
+}
 
-            /* Mark the resource as available again */
-            mark_resource_as_available(instr->resource_name);
+/**
+ * @brief Wakes the waiting processes that are blocked on <code>resource</code>
+ *        only because they want a resource below it in the hierarchy
+ */
+void wake_waiters_below(resource_t *resource)
+{
+    pcb_t *pcb, *next;
 
-            log_release_released(pcb->process_in_mem->name, instr->resource_name);
-            free(cur); /* Free the resource node */
-            break;
+    for (pcb = waitingq.first; pcb != NULL; pcb = next) {
+        next = pcb_next(pcb);
+        if (pcb_cold(pcb)->blocked_on == resource && !requests_resource(pcb->next_instruction, resource->name)) {
+            unlink_waiting(pcb);
+            wake_proc(pcb);
         }
-        prev = cur;
-        cur = cur->next;
-    }
-
-    if (!found) {
-        log_release_error(pcb->process_in_mem->name, instr->resource_name);
-    } else {
-        /* Check waiting queue for processes waiting for this resource */
-        move_waiting_pcbs_to_rq(instr->resource_name);
     }
 }
 
@@ -473,11 +1681,12 @@ void release_resource(pcb_t *pcb, instr_t *instr)
 bool_t check_for_new_arrivals()
 {
     bool_t newProcessAdded = FALSE;
-    pcb_t *new_pcb = get_new_pcb();
+    pcb_t *new_pcb = dequeue_pcb(&arrivalq);
 
     if (new_pcb) {
-        printf("New process arriving: %s\n", new_pcb->process_in_mem->name);
-        move_proc_to_rq(new_pcb);
+        log_arrival(pcb_mem(new_pcb)->name);
+        start_job(new_pcb, sim_clock);
+        wake_proc(new_pcb);
         newProcessAdded = TRUE;
     }
 
@@ -495,23 +1704,84 @@ void move_proc_to_rq(pcb_t *pcb)
 
     /* Update process state */
     pcb->state = READY;
+    pcb_cold(pcb)->blocked_on = NULL;
+    pcb_cold(pcb)->ready_seq = ready_clock++;
 
-    enqueue_pcb(pcb, &readyq);
-    log_request_ready(pcb->process_in_mem->name);
+    if (policy != NULL) policy->enqueue(pcb);
+    else enqueue_pcb(pcb, &readyq);
+    log_request_ready(pcb_mem(pcb)->name);
+}
+
+/**
+ * @brief Moves a process that was not on the CPU (it waited, arrived or
+ *        released a new job) to the ready queue
+ *
+ * @param[in] pcb
+ */
+void wake_proc(pcb_t *pcb)
+{
+    if (policy != NULL && policy->on_wakeup != NULL) policy->on_wakeup(pcb);
+    move_proc_to_rq(pcb);
+}
+
+/**
+ * @brief Returns TRUE if no process is ready to run
+ */
+bool_t readyq_empty()
+{
+    return (readyq.first == NULL && readyh.size == 0 && readyt.count == 0 && readyk.count == 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Moves <code>pcb</code> past the instruction it just executed
+ */
+void advance_instr(pcb_t *pcb)
+{
+    pcb->next_instruction = pcb->next_instruction->next;
+    pcb_cold(pcb)->remaining--;
 }
 
 /**
- * Move process <code>pcb</code> to waiting queue
+ * Move process <code>pcb</code>, blocked on request <code>instr</code>, to
+ * waiting queue
  */
-void move_proc_to_wq(pcb_t *pcb, char *resource_name)
+void move_proc_to_wq(pcb_t *pcb, instr_t *instr, char *resource_name)
 {
     if (pcb == NULL) return;
 
     /* Update process state */
     pcb->state = WAITING;
 
+    pcb->prev = pcb_id(waitingq.last);
     enqueue_pcb(pcb, &waitingq);
-    log_request_waiting(pcb->process_in_mem->name, resource_name);
+    log_request_waiting(pcb_mem(pcb)->name, request_op(instr), resource_name);
+}
+
+/**
+ * @brief Returns the mnemonic of request <code>instr</code> as written in
+ *        the workload
+ */
+static char *request_op(instr_t *instr)
+{
+    if (instr->timeout == 0) return TRYREQ;
+    return instr->shared ? REQS : REQ;
+}
+
+/**
+ * @brief Removes <code>pcb</code> from the waiting queue in O(1), cancels
+ *        the timeout of its request and takes it off the waiters of its
+ *        resource in O(log n)
+ */
+void unlink_waiting(pcb_t *pcb)
+{
+    if (pcb->prev != NO_PCB) pcb_at(pcb->prev)->next = pcb->next;
+    else waitingq.first = pcb_next(pcb);
+    if (pcb->next != NO_PCB) pcb_next(pcb)->prev = pcb->prev;
+    else waitingq.last = pcb_at(pcb->prev);
+    pcb->next = NO_PCB;
+    pcb->prev = NO_PCB;
+    pcb_heap_remove(&timerh, pcb);
+    remove_waiter(pcb);
 }
 
 /**
@@ -525,9 +1795,50 @@ void move_proc_to_tq(pcb_t *pcb)
 
     /* Update process state */
     pcb->state = TERMINATED;
+    release_held_resources(pcb);
+
+    log_terminated(pcb_mem(pcb)->name);
+    if (stream_metrics) {
+        total_terminated++;
+        if (pcb_mem(pcb)->deadline > 0) {
+            total_jobs += pcb_cold(pcb)->jobs;
+            total_misses += pcb_cold(pcb)->deadline_misses;
+            if (pcb_cold(pcb)->max_lateness > worst_lateness) worst_lateness = pcb_cold(pcb)->max_lateness;
+        }
+        dealloc_pcb(pcb);
+    } else if (recycle_terminated && pcb_mem(pcb)->deadline == 0) {
+        /* Nothing is reported about it any more: its pcb goes back to the pool */
+        dealloc_pcb(pcb);
+    } else {
+        enqueue_pcb(pcb, &terminatedq);
+    }
+}
+
+/**
+ * @brief Releases the resources a terminating process still holds, so that
+ *        their waiters are not stranded, and logs each leaked hold.
+ *
+ * The waiters are woken as on a release instruction: one by handoff, or all
+ * of them.
+ *
+ * @param[in] pcb
+ */
+void release_held_resources(pcb_t *pcb)
+{
+    resource_t *held;
+    resource_t *resource;
 
-    enqueue_pcb(pcb, &terminatedq);
-    log_terminated(pcb->process_in_mem->name);
+    if (pcb_cold(pcb)->resources == NULL) return;
+
+    while ((held = pcb_cold(pcb)->resources) != NULL) {
+        pcb_cold(pcb)->resources = held->next;
+        resource = get_resource(held->id);
+
+        log_leaked_resource(pcb_mem(pcb)->name, resource->name);
+        if (drop_hold(resource, held->shared) && !handoff_release) move_waiting_pcbs_to_rq(resource->name);
+        free(held);
+    }
+    if (!handoff_release) move_waiting_to_ready_based_on_resources();
 }
 
 /**
@@ -539,30 +1850,20 @@ void move_proc_to_tq(pcb_t *pcb)
  */
 void move_waiting_pcbs_to_rq(char *resource_name)
 {
-    pcb_t *prev = NULL;
     pcb_t *current = waitingq.first;
     pcb_t *temp;
 
     while (current != NULL)
     {
+        temp = pcb_next(current);
+
         /* Check if the current process is waiting for the given resource */
         if (is_waiting_for_resource(current, resource_name)) {
-            temp = current->next;
-
-            /* Remove current process from waiting queue */
-            if (prev != NULL) prev->next = current->next;
-            else  waitingq.first = current->next;
-            if (waitingq.last == current) waitingq.last = prev;
-
             /* Move current process to ready queue */
-            current->next = NULL;
-            move_proc_to_rq(current);
-
-            current = temp; /* Continue with the next process */
-        } else{
-            prev = current;
-            current = current->next;
+            unlink_waiting(current);
+            wake_proc(current);
         }
+        current = temp; /* Continue with the next process */
     }
 }
 
@@ -578,8 +1879,8 @@ void enqueue_pcb(pcb_t *pcb, pcb_queue_t *queue)
 {
     if (pcb == NULL || queue == NULL) return;
 
-    /* Initialize the next pointer of the process to ensure it's the last in the queue */
-    pcb->next = NULL;
+    /* Initialize the next link of the process to ensure it's the last in the queue */
+    pcb->next = NO_PCB;
 
     /* If the queue is empty, the new process is both the first and last element */
     if (queue->first == NULL) {
@@ -587,7 +1888,7 @@ void enqueue_pcb(pcb_t *pcb, pcb_queue_t *queue)
         queue->last = pcb;
     } else {
         /* If the queue is not empty, append the process to the end and update the last pointer */
-        queue->last->next = pcb;
+        queue->last->next = pcb->id;
         queue->last = pcb;
     }
 }
@@ -607,14 +1908,14 @@ pcb_t *dequeue_pcb(pcb_queue_t *queue)
     /* Store the first process in the queue */
     pcb_t *proc = queue->first;
 
-    queue->first = queue->first->next;
+    queue->first = pcb_next(queue->first);
 
     /* If the queue becomes empty, make sure the last pointer is also NULL */
     if (queue->first == NULL) {
         queue->last = NULL;
     }
 
-    proc->next = NULL;
+    proc->next = NO_PCB;
     return proc;
 }
 
@@ -631,6 +1932,249 @@ bool_t higher_priority(int pri1, int pri2)
     return pri1 > pri2 ? TRUE : FALSE;
 }
 
+/** @brief Orders priority scheduling by priority (highest first), then by
+ *         arrival in the ready queue
+ */
+bool_t higher_priority_first(pcb_t *a, pcb_t *b)
+{
+    if (a->priority != b->priority) return higher_priority(a->priority, b->priority);
+    return pcb_cold(a)->ready_seq < pcb_cold(b)->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders the waiters of a resource by priority (highest first), then
+ *         by the time they started to wait
+ */
+bool_t higher_priority_waiter(pcb_t *a, pcb_t *b)
+{
+    if (a->priority != b->priority) return higher_priority(a->priority, b->priority);
+    return pcb_cold(a)->wait_seq < pcb_cold(b)->wait_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders the waiters of a resource by the time they started to wait
+ */
+bool_t earlier_waiter(pcb_t *a, pcb_t *b)
+{
+    return pcb_cold(a)->wait_seq < pcb_cold(b)->wait_seq ? TRUE : FALSE;
+}
+
+/** @brief Return TRUE if process a has fewer instructions left than b,
+ *         the process that became ready first wins a tie
+ */
+bool_t shorter_job(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->remaining != cb->remaining) return ca->remaining < cb->remaining ? TRUE : FALSE;
+    return ca->ready_seq < cb->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders the fair scheduler's tree by vruntime, then by arrival
+ *         in the ready queue
+ */
+int less_vruntime(const rb_node_t *a, const rb_node_t *b)
+{
+    const pcb_cold_t *pa = rb_entry(a, pcb_cold_t, rb_node);
+    const pcb_cold_t *pb = rb_entry(b, pcb_cold_t, rb_node);
+
+    if (pa->vruntime != pb->vruntime) return pa->vruntime < pb->vruntime;
+    return pa->ready_seq < pb->ready_seq;
+}
+
+/** @brief Orders aging priority scheduling by age_key (highest first), then
+ *         by arrival in the ready queue
+ */
+bool_t higher_aged_priority(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->age_key != cb->age_key) return ca->age_key > cb->age_key ? TRUE : FALSE;
+    return ca->ready_seq < cb->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders stride scheduling by pass, then by arrival in the ready queue
+ */
+bool_t lower_pass(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->vruntime != cb->vruntime) return ca->vruntime < cb->vruntime ? TRUE : FALSE;
+    return ca->ready_seq < cb->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Returns the proportional share tickets of a process
+ */
+long get_tickets(pcb_t *pcb)
+{
+    return pcb->priority < 0 ? 1 : (long)pcb->priority + 1;
+}
+
+/** @brief xorshift64* generator for lottery draws, seeded per simulation
+ *         so that runs are reproducible
+ */
+unsigned long long lottery_rand()
+{
+    lottery_state ^= lottery_state >> 12;
+    lottery_state ^= lottery_state << 25;
+    lottery_state ^= lottery_state >> 27;
+    return lottery_state * 2685821657736338717ULL;
+}
+
+/** @brief Orders EDF scheduling by absolute deadline, then by arrival in the
+ *         ready queue
+ */
+bool_t earlier_deadline(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->abs_deadline != cb->abs_deadline) return ca->abs_deadline < cb->abs_deadline ? TRUE : FALSE;
+    return ca->ready_seq < cb->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders rate-monotonic scheduling by period (none is longest), then
+ *         by arrival in the ready queue
+ */
+bool_t shorter_period(pcb_t *a, pcb_t *b)
+{
+    int period_a = pcb_mem(a)->period ? pcb_mem(a)->period : INT_MAX;
+    int period_b = pcb_mem(b)->period ? pcb_mem(b)->period : INT_MAX;
+
+    if (period_a != period_b) return period_a < period_b ? TRUE : FALSE;
+    return pcb_cold(a)->ready_seq < pcb_cold(b)->ready_seq ? TRUE : FALSE;
+}
+
+/** @brief Orders the processes waiting on a timed request by the time they give up
+ */
+bool_t earlier_timeout(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->wait_until != cb->wait_until) return ca->wait_until < cb->wait_until ? TRUE : FALSE;
+    return pcb_mem(a)->number < pcb_mem(b)->number ? TRUE : FALSE;
+}
+
+/** @brief Orders the processes waiting for their next job by release time
+ */
+bool_t earlier_release(pcb_t *a, pcb_t *b)
+{
+    pcb_cold_t *ca = pcb_cold(a), *cb = pcb_cold(b);
+
+    if (ca->release != cb->release) return ca->release < cb->release ? TRUE : FALSE;
+    return pcb_mem(a)->number < pcb_mem(b)->number ? TRUE : FALSE;
+}
+
+/**
+ * @brief Starts a new job of <code>pcb</code>: rewinds its instructions and
+ *        sets the release time and absolute deadline
+ */
+void start_job(pcb_t *pcb, long release)
+{
+    instr_t *instr;
+
+    pcb->next_instruction = pcb_mem(pcb)->first_instr;
+    pcb_cold(pcb)->remaining = 0;
+    for (instr = pcb->next_instruction; instr != NULL; instr = instr->next) pcb_cold(pcb)->remaining++;
+
+    pcb_cold(pcb)->release = release;
+    pcb_cold(pcb)->abs_deadline = pcb_mem(pcb)->deadline ? release + pcb_mem(pcb)->deadline : LONG_MAX;
+}
+
+/**
+ * @brief Records the completion of the current job of <code>pcb</code> and
+ *        schedules its next release, or terminates it
+ *
+ * A job that completes after the release of the next job releases that job
+ * at once; the next job keeps its own deadline.
+ */
+void complete_job(pcb_t *pcb)
+{
+    long lateness;
+    pcb_cold_t *cold = pcb_cold(pcb);
+    long next_release = cold->release + pcb_mem(pcb)->period;
+
+    cold->jobs++;
+    if (cold->abs_deadline != LONG_MAX) {
+        lateness = sim_clock - cold->abs_deadline;
+        if (lateness > cold->max_lateness) cold->max_lateness = lateness;
+        if (lateness > 0) {
+            cold->deadline_misses++;
+            log_deadline_miss(pcb_mem(pcb)->name, cold->jobs, cold->abs_deadline, sim_clock);
+        }
+    }
+
+    if (pcb_mem(pcb)->period > 0 && next_release < rt_horizon) {
+        start_job(pcb, next_release);
+        pcb->state = NEW;
+        pcb_heap_push(&releaseh, pcb);
+    } else {
+        move_proc_to_tq(pcb);
+    }
+}
+
+/**
+ * @brief Moves the periodic processes whose next job is due to the ready queue
+ */
+void release_due_jobs()
+{
+    pcb_t *pcb;
+
+    while ((pcb = pcb_heap_peek(&releaseh)) != NULL && pcb_cold(pcb)->release <= sim_clock) {
+        pcb_heap_pop(&releaseh);
+        log_job_release(pcb_mem(pcb)->name, pcb_cold(pcb)->jobs + 1, pcb_cold(pcb)->release);
+        wake_proc(pcb);
+    }
+}
+
+/**
+ * @brief Returns the least common multiple of the periods of all processes,
+ *        at most RT_MAX_HORIZON
+ */
+long rt_hyperperiod()
+{
+    pcb_queue_t *queues[] = {&readyq, &arrivalq};
+    pcb_t *pcb;
+    long lcm = 1, a, b, t;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        for (pcb = queues[i]->first; pcb != NULL; pcb = pcb_next(pcb)) {
+            if (pcb_mem(pcb)->period <= 0) continue;
+            a = lcm;
+            b = pcb_mem(pcb)->period;
+            while (b != 0) {
+                t = a % b;
+                a = b;
+                b = t;
+            }
+            lcm = lcm / a * pcb_mem(pcb)->period;
+            if (lcm >= RT_MAX_HORIZON) return RT_MAX_HORIZON;
+        }
+    }
+    return lcm;
+}
+
+/**
+ * @brief Logs the jobs, deadline misses and worst lateness of every
+ *        process that has a deadline
+ */
+void print_rt_summary()
+{
+    pcb_t *pcb;
+
+    for (pcb = terminatedq.first; pcb != NULL; pcb = pcb_next(pcb)) {
+        if (pcb_mem(pcb)->deadline == 0) continue;
+        log_rt_summary(pcb_mem(pcb)->name, pcb_cold(pcb)->jobs, pcb_cold(pcb)->deadline_misses, pcb_cold(pcb)->max_lateness);
+    }
+}
+
+/** @brief Returns the CPU share weight of a priority
+ */
+unsigned long cfs_weight(int priority)
+{
+    if (priority < 0) priority = 0;
+    if (priority > CFS_MAX_PRIORITY) priority = CFS_MAX_PRIORITY;
+    return cfs_weights[priority];
+}
+
 /**
  * @brief Inspect the waiting queue and detects deadlock
  */
@@ -657,7 +2201,10 @@ void resolve_deadlock(struct pcb_t *pcb)
 }
 
 /**
- * @brief Deallocates the queues
+ * @brief Deallocates the queues and heaps of a simulation
+ *
+ * The pcbs still queued go back to the pool unless they are read after
+ * the run; the ones that are stay live until dealloc_data_structures.
  */
 void free_manager(void)
 {
@@ -670,9 +2217,16 @@ void free_manager(void)
 #ifdef DEBUG_MNGR
     printf("\nFreeing the queues...\n");
 #endif
-    dealloc_pcb_list(readyq.first);
-    dealloc_pcb_list(waitingq.first);
-    dealloc_pcb_list(terminatedq.first);
+    if (recycle_terminated) {
+        dealloc_pcb_list(readyq.first);
+        dealloc_pcb_list(waitingq.first);
+        dealloc_pcb_list(terminatedq.first);
+    }
+    readyq.first = readyq.last = NULL;
+    waitingq.first = waitingq.last = NULL;
+    terminatedq.first = terminatedq.last = NULL;
+    free_pcb_heap(&readyh);
+    free_pcb_heap(&releaseh);
 }
 
 /**
@@ -713,12 +2267,59 @@ int get_time_quantum(int num_args, char **argv)
     else return 1;
 }
 
+/**
+ * @brief Retrieves the option words that follow the time quantum
+ *
+ * @return A bitmask of option_t flags
+ */
+int get_options(int num_args, char **argv)
+{
+    int options = OPT_NONE;
+    int i;
+
+    for (i = 5; i < num_args; i++) {
+        if (strcmp(argv[i], OPT_PARTITION_STR) == 0) options |= OPT_PARTITION;
+        else if (strcmp(argv[i], OPT_TIME_WARP_STR) == 0) options |= OPT_TIME_WARP;
+        else if (strcmp(argv[i], OPT_ANALYZE_STR) == 0) options |= OPT_ANALYZE;
+        else if (strcmp(argv[i], OPT_INHERIT_STR) == 0) options |= OPT_INHERIT;
+        else if (strcmp(argv[i], OPT_CEILING_STR) == 0) options |= OPT_CEILING;
+        else if (strcmp(argv[i], OPT_RUNNABLE_STR) == 0) options |= OPT_RUNNABLE;
+        else if (strcmp(argv[i], OPT_HANDOFF_STR) == 0) options |= OPT_HANDOFF;
+        else if (strcmp(argv[i], OPT_LOCK_ORDER_STR) == 0) options |= OPT_LOCK_ORDER;
+        else if (strcmp(argv[i], OPT_EXPLORE_STR) == 0) options |= OPT_EXPLORE;
+        else if (strcmp(argv[i], OPT_STREAM_STR) == 0) options |= OPT_STREAM;
+        else if (strncmp(argv[i], OPT_THREADS_STR, strlen(OPT_THREADS_STR)) != 0)
+            printf("Unknown option %s\n", argv[i]);
+    }
+    return options;
+}
+
+/**
+ * @brief Retrieves the number of worker threads from a "threads=N" option
+ *
+ * @return N, or 0 to use one thread per online processor
+ */
+int get_num_threads(int num_args, char **argv)
+{
+    size_t len = strlen(OPT_THREADS_STR);
+    int i;
+
+    for (i = 5; i < num_args; i++) {
+        if (strncmp(argv[i], OPT_THREADS_STR, len) == 0) return atoi(argv[i] + len);
+    }
+    return 0;
+}
+
 /**
  * @brief Print the arguments of the program
  */
 void print_args(char *data1, char *data2, int sched, int tq)
 {
-    printf("Arguments: data1 = %s, data2 = %s, scheduler = %s,  time quantum = %d\n", data1, data2, (sched == 0) ? "priority" : "RR", tq);
+    char *sched_names[] = {"priority", "RR", "FCFS", "SJF", "SRTF", "CFS", "stride", "lottery", "EDF", "RM",
+                           "priority with aging"};
+    char *name = (sched >= 0 && sched <= AGING) ? sched_names[sched] : "unknown";
+
+    printf("Arguments: data1 = %s, data2 = %s, scheduler = %s,  time quantum = %d\n", data1, data2, name, tq);
 }
 
 /**
@@ -745,8 +2346,8 @@ void print_alloc_resources(pcb_t *proc)
     struct resource_t *resource;
 
     if (proc)  {
-        printf("Allocated to %s:", proc->process_in_mem->name);
-        for (resource = proc->resources; resource != NULL; resource = resource->next) {
+        printf("Allocated to %s:", pcb_mem(proc)->name);
+        for (resource = pcb_cold(proc)->resources; resource != NULL; resource = resource->next) {
             printf(" %s", resource->name);
         }
         printf(" ");
@@ -762,8 +2363,8 @@ void print_queue(pcb_queue_t queue, char *msg)
 
     printf("%s:", msg);
     while (proc != NULL) {
-        printf(" %s", proc->process_in_mem->name);
-        proc = proc->next;
+        printf(" %s", pcb_mem(proc)->name);
+        proc = pcb_next(proc);
     }
     printf(" ");
 }
@@ -775,7 +2376,7 @@ void print_running(pcb_t *proc, char *msg)
 {
     printf("%s:", msg);
     if (proc != NULL) {
-        printf(" %s", proc->process_in_mem->name);
+        printf(" %s", pcb_mem(proc)->name);
     }
     printf(" ");
 }
@@ -809,17 +2410,27 @@ void print_instructions(instr_t *instr)
 
 /**
  * @brief Marks resources as available
- * @param resource_name The name of the resource to mark as available
+ * @param resource The resource to mark as available
  */
-void mark_resource_as_available(char *resource_name)
+void mark_resource_as_available(resource_t *resource)
 {
-    resource_t *resource = get_available_resources();
-    while (resource != NULL)  {
-        if (strcmp(resource->name, resource_name) == 0)  {
-            resource->available = YES;
-            break;
-        }
-        resource = resource->next;
+    resource->available = YES;
+    resource->holder = NULL;
+    free_bits[resource->id / RESOURCE_BITS] |= 1UL << (resource->id % RESOURCE_BITS);
+}
+
+/**
+ * @brief Marks a resource as available if nobody holds it or a resource
+ *        below it, and as unavailable otherwise
+ */
+void update_availability(resource_t *resource)
+{
+    if (resource->holder == NULL && resource->readers == 0
+        && resource->intent_shared == 0 && resource->intent_exclusive == 0) {
+        mark_resource_as_available(resource);
+    } else {
+        resource->available = NO;
+        free_bits[resource->id / RESOURCE_BITS] &= ~(1UL << (resource->id % RESOURCE_BITS));
     }
 }
 
@@ -850,104 +2461,23 @@ bool_t is_waiting_for_resource(pcb_t *pcb, char *resource_name)
     return FALSE;
 }
 
-/**
- * @brief Finds the process with the highest priority in the ready queue
- * @return The process that holds the resource, or NULL if not found
- */
-pcb_t *find_highest_priority_proc()
-{
-    pcb_t *current = readyq.first;
-    pcb_t *highest_priority_proc = NULL;
-    int highest_priority = INT_MIN;
-
-    while (current != NULL) {
-        if (current->priority > highest_priority) {
-            highest_priority = current->priority;
-            highest_priority_proc = current;
-        }
-        current = current->next;
-    }
-
-    return highest_priority_proc;
-}
-
-/**
- * @brief removes a process from the ready queue
- * @param proc The process to remove
- */
-void remove_proc_from_readyq(pcb_t *proc)
-{
-    if (proc == NULL || readyq.first == NULL) return;
-
-    if (readyq.first == proc) {
-        /* If the process to remove is the first in the queue */
-        readyq.first = proc->next;
-        if (readyq.last == proc) {
-            /* If it was also the last process, then the queue is now empty */
-            readyq.last = NULL;
-        }
-    } else {
-        /* If the process is not the first, find it in the queue */
-        pcb_t *current = readyq.first;
-        while (current != NULL && current->next != proc) {
-            current = current->next;
-        }
-
-        if (current != NULL) {
-            /* Remove the process from the queue */
-            current->next = proc->next;
-            if (readyq.last == proc)  {
-                readyq.last = current;
-            }
-        }
-    }
-    proc->next = NULL;
-}
-
 /**
  * @brief Moves processes from the waiting queue to the ready queue based on resource availability
  */
 void move_waiting_to_ready_based_on_resources()
 {
-    pcb_t **current = &waitingq.first;
-    pcb_t *prev = NULL;
+    pcb_t *process = waitingq.first;
+    pcb_t *next;
 
-    while (*current != NULL) {
-        pcb_t *process = *current;
-        bool_t canMoveToReady = FALSE;
-
-        if (process->next_instruction) {
-            const char *requiredResource = process->next_instruction->resource_name;
-            if (is_resource_available(requiredResource)) {
-                canMoveToReady = TRUE;
-            }
-        }
+    while (process != NULL) {
+        next = pcb_next(process);
 
-        if (canMoveToReady) {
+        if (process->next_instruction && request_grantable(process->next_instruction)) {
             /* Remove from waiting queue */
-            if (prev != NULL) {
-                prev->next = process->next;
-            } else {
-                waitingq.first = process->next;
-            }
-
-            /* If it was the last process in the waiting queue */
-            if (waitingq.last == process) {
-                waitingq.last = prev;
-            }
-
-            move_proc_to_rq(process);
-
-            /* Adjust current pointer if process was removed */
-            if (prev != NULL) {
-                current = &(prev->next);
-            } else {
-                current = &waitingq.first;
-            }
-        } else {
-            prev = *current;
-            current = &((*current)->next);
+            unlink_waiting(process);
+            wake_proc(process);
         }
+        process = next;
     }
 }
 
@@ -990,7 +2520,7 @@ bool_t is_resource_available_for_process(pcb_t *process)
  */
 bool_t check_deadlock()
 {
-    if (readyq.first == NULL && waitingq.first != NULL) {
+    if (readyq_empty() && waitingq.first != NULL) {
         detect_deadlock();
         return TRUE;
     }
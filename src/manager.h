@@ -7,17 +7,70 @@
 #include "proc_structs.h"
 #include "proc_gen.h"
 
-typedef enum {PRIOR = 0, RR, FCFS} schedule_t;
+typedef enum {PRIOR = 0, RR, FCFS, SJF, SRTF, CFS, STRIDE, LOTTERY, EDF, RM, AGING} schedule_t;
+
+/** Options given as words after the time quantum */
+typedef enum {OPT_NONE = 0, OPT_PARTITION = 1 << 0, OPT_TIME_WARP = 1 << 1, OPT_ANALYZE = 1 << 2,
+              OPT_INHERIT = 1 << 3, OPT_CEILING = 1 << 4, OPT_RUNNABLE = 1 << 5,
+              OPT_HANDOFF = 1 << 6, OPT_LOCK_ORDER = 1 << 7,
+              OPT_EXPLORE = 1 << 8, OPT_STREAM = 1 << 9} option_t;
+
+#define OPT_PARTITION_STR "partition"
+#define OPT_TIME_WARP_STR "timewarp"
+#define OPT_THREADS_STR "threads="
+#define OPT_ANALYZE_STR "analyze"
+#define OPT_INHERIT_STR "inherit"
+#define OPT_CEILING_STR "ceiling"
+#define OPT_RUNNABLE_STR "runnable"
+#define OPT_HANDOFF_STR "handoff"
+#define OPT_LOCK_ORDER_STR "lockorder"
+#define OPT_EXPLORE_STR "explore"
+#define OPT_STREAM_STR "stream"
+
+/** Storage class of the per-simulation scheduler state */
+#define SIM_LOCAL _Thread_local
 
 typedef struct pcb_queue_t {
     struct pcb_t *first;
     struct pcb_t *last;
 } pcb_queue_t;
 
+/**
+ * A scheduling policy: where the ready processes are kept and which one runs
+ * next. Every scheduler runs in the same execution loop, which calls these
+ * hooks; the hooks marked optional may be NULL.
+ */
+typedef struct sched_policy_t {
+    /** Prepares the ready store before the loaded processes are enqueued (optional) */
+    void (*init)(void);
+    /** Adds a process that became ready */
+    void (*enqueue)(pcb_t *pcb);
+    /** Removes and returns the process to run next, NULL if none is ready */
+    pcb_t *(*pick_next)(void);
+    /** The running process just blocked on a resource (optional) */
+    void (*on_block)(pcb_t *pcb);
+    /** A process is about to be enqueued after waiting, arriving or a release (optional) */
+    void (*on_wakeup)(pcb_t *pcb);
+    /** The running process executed an instruction (optional) */
+    void (*on_tick)(pcb_t *pcb);
+    /** Returns TRUE if the running process must go back to the ready store (optional) */
+    bool_t (*should_preempt)(pcb_t *pcb);
+    /** The running process ran out of instructions (optional, it terminates by default) */
+    void (*on_complete)(pcb_t *pcb);
+    /** Nothing is ready; returns TRUE if the policy moved time or processes on (optional) */
+    bool_t (*on_idle)(void);
+    /** The priority of a process changed from old_priority (optional) */
+    void (*on_priority)(pcb_t *pcb, int old_priority);
+    /** Called after the last process has run (optional) */
+    void (*finish)(void);
+    /** TRUE if a released resource goes to its highest priority waiter, else to the first */
+    bool_t by_priority;
+} sched_policy_t;
+
 /* --- Function Prototypes -------------------------------------------------- */
 
 /** Initializes the manager. */
-void init_queues(pcb_t *procs_loaded);
+void init_queues(pcb_t *procs_loaded, pcb_t *procs_arriving);
 
 /**
  * Schedules processes.
@@ -27,6 +80,14 @@ void init_queues(pcb_t *procs_loaded);
  */
 void schedule_processes(schedule_t algorithm, int time_quantum);
 
+/**
+ * Schedules processes with a policy in the shared execution loop.
+ *
+ * @param[in]  policy
+ * @param[in]  time_quantum
+ */
+void run_policy(const sched_policy_t *policy, int time_quantum);
+
 /** Frees the manager. */
 void free_manager(void);
 
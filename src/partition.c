@@ -0,0 +1,321 @@
+/**
+ * @file partition.c
+ * @brief Splits a workload into independent simulations and runs them on
+ *        worker threads.
+ *
+ * Processes that never name a common resource or mailbox cannot interact,
+ * so the connected components of the process/resource graph can be
+ * scheduled separately. Components are found with union-find over the
+ * instruction lists, each component gets its own CPU (a worker thread with
+ * its own thread local queues) and the logs of the components are written
+ * in component order once all workers are done, so the output does not
+ * depend on thread timing.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "proc_structs.h"
+#include "pcb_pool.h"
+#include "logger.h"
+#include "lf_queue.h"
+#include "manager.h"
+#include "partition.h"
+#include "str_table.h"
+
+/** The processes and captured logs of one independent simulation */
+typedef struct component_t {
+    pcb_queue_t init;
+    pcb_queue_t arriving;
+    log_capture_t log;
+} component_t;
+
+/** State shared by the worker threads */
+typedef struct partition_run_t {
+    lf_pcb_queue_t workq; /* the leading pcb of every component not yet run */
+    component_t *components;
+    int *component_of; /* component index by process number */
+    schedule_t algorithm;
+    int time_quantum;
+} partition_run_t;
+
+static int find_root(int *parent, int x);
+static void union_sets(int *parent, int a, int b);
+static void append_pcb(pcb_queue_t *queue, pcb_t *pcb);
+static void *run_components(void *arg);
+
+/**
+ * @brief Schedules every connected component of the workload as its own
+ *        simulation.
+ *
+ * @param init_procs The processes that are ready at the start
+ * @param arrivals The processes that arrive during scheduling
+ * @param algorithm The scheduling algorithm each simulation uses
+ * @param time_quantum The time quantum passed on to the scheduler
+ * @param num_threads The number of worker threads, 0 for one per processor
+ */
+void schedule_partitioned(pcb_t *init_procs, pcb_t *arrivals, schedule_t algorithm,
+                          int time_quantum, int num_threads)
+{
+    partition_run_t run;
+    pcb_t **procs, *pcb;
+    pthread_t *workers;
+    int *component;
+    int num_procs = 0, num_components;
+    int num_init, i, c, max_number = 0;
+
+    /* Collect the processes in load order: initial ones first */
+    for (pcb = init_procs; pcb != NULL; pcb = pcb_next(pcb)) num_procs++;
+    num_init = num_procs;
+    for (pcb = arrivals; pcb != NULL; pcb = pcb_next(pcb)) num_procs++;
+    if (num_procs == 0) return;
+
+    procs = malloc(num_procs * sizeof(pcb_t *));
+    i = 0;
+    for (pcb = init_procs; pcb != NULL; pcb = pcb_next(pcb)) procs[i++] = pcb;
+    for (pcb = arrivals; pcb != NULL; pcb = pcb_next(pcb)) procs[i++] = pcb;
+
+    component = malloc(num_procs * sizeof(int));
+    num_components = label_components(procs, num_procs, component);
+
+    for (i = 0; i < num_procs; i++) {
+        if (pcb_mem(procs[i])->number > max_number) max_number = pcb_mem(procs[i])->number;
+    }
+    run.component_of = calloc(max_number + 1, sizeof(int));
+    for (i = 0; i < num_procs; i++) run.component_of[pcb_mem(procs[i])->number] = component[i];
+
+    run.components = calloc(num_components, sizeof(component_t));
+    for (i = 0; i < num_procs; i++) {
+        c = run.component_of[pcb_mem(procs[i])->number];
+        append_pcb(i < num_init ? &run.components[c].init : &run.components[c].arriving, procs[i]);
+    }
+
+    /* A component of late arrivals starts with its first arrival */
+    for (c = 0; c < num_components; c++) {
+        if (run.components[c].init.first == NULL) {
+            pcb = run.components[c].arriving.first;
+            run.components[c].arriving.first = pcb_next(pcb);
+            if (run.components[c].arriving.first == NULL) run.components[c].arriving.last = NULL;
+            pcb->next = NO_PCB;
+            run.components[c].init.first = pcb;
+            run.components[c].init.last = pcb;
+        }
+    }
+
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0) num_threads = 1;
+    if (num_threads > num_components) num_threads = num_components;
+
+    printf("Partitioned into %d independent simulation(s) on %d thread(s)\n",
+           num_components, num_threads);
+
+    if (!init_lf_queue(&run.workq, num_components)) {
+        fprintf(stderr, "Error: could not share the partitions between threads\n");
+        free(run.components);
+        free(run.component_of);
+        free(component);
+        free(procs);
+        return;
+    }
+    for (c = 0; c < num_components; c++) lf_enqueue_pcb(run.components[c].init.first, &run.workq);
+    run.algorithm = algorithm;
+    run.time_quantum = time_quantum;
+
+    workers = malloc(num_threads * sizeof(pthread_t));
+    for (i = 1; i < num_threads; i++) {
+        if (pthread_create(&workers[i], NULL, run_components, &run) != 0) {
+            fprintf(stderr, "Error: could not start worker thread %d\n", i);
+            num_threads = i;
+            break;
+        }
+    }
+    /* The main thread works as well */
+    run_components(&run);
+    for (i = 1; i < num_threads; i++) pthread_join(workers[i], NULL);
+
+    /* Merge the results in component order */
+    for (c = 0; c < num_components; c++) {
+        printf("--- Partition %d:", c + 1);
+        for (i = 0; i < num_procs; i++) {
+            if (run.component_of[pcb_mem(procs[i])->number] == c)
+                printf(" %s", pcb_mem(procs[i])->name);
+        }
+        printf(" ---\n");
+        log_capture_flush(&run.components[c].log);
+    }
+
+    free(workers);
+    free_lf_queue(&run.workq);
+    free(run.components);
+    free(run.component_of);
+    free(component);
+    free(procs);
+}
+
+/**
+ * @brief Labels the connected components of a set of processes
+ *
+ * Processes are sets 0..num_procs-1 and every resource or mailbox name is a
+ * set after them. Each instruction joins its process with the name it uses,
+ * and every resource in a hierarchy is joined with its parent, whose
+ * intention locks tie the processes below it together.
+ *
+ * @param procs The processes
+ * @param num_procs The number of processes
+ * @param component Receives the component of every process, numbered in
+ *        order of the first process of each component
+ *
+ * @return The number of components
+ */
+int label_components(pcb_t **procs, int num_procs, int *component)
+{
+    name_table_t table;
+    instr_t *instr;
+    int *parent, *root_component;
+    int num_components = 0;
+    resource_t *resource;
+    int i, k, id, parent_id, root;
+    size_t num_sets, j;
+
+    init_name_table(&table);
+    num_sets = (size_t)num_procs + (size_t)str_count();
+    parent = malloc(num_sets * sizeof(int));
+    for (j = 0; j < num_sets; j++) parent[j] = (int)j;
+
+    for (i = 0; i < num_procs; i++) {
+        for (instr = pcb_mem(procs[i])->first_instr; instr != NULL; instr = instr->next) {
+            if ((id = name_to_id(&table, instr->resource_name)) >= 0) union_sets(parent, i, num_procs + id);
+            for (k = 0; k < instr->set_size; k++) {
+                if ((id = name_to_id(&table, instr->set_names[k])) >= 0) union_sets(parent, i, num_procs + id);
+            }
+        }
+    }
+    for (k = 0; k < get_num_resources(); k++) {
+        resource = get_resource(k);
+        if (resource == NULL || resource->parent == NULL) continue;
+        id = name_to_id(&table, resource->name);
+        parent_id = name_to_id(&table, resource->parent->name);
+        if (id >= 0 && parent_id >= 0) union_sets(parent, num_procs + id, num_procs + parent_id);
+    }
+
+    root_component = malloc(num_sets * sizeof(int));
+    for (j = 0; j < num_sets; j++) root_component[j] = -1;
+    for (i = 0; i < num_procs; i++) {
+        root = find_root(parent, i);
+        if (root_component[root] < 0) root_component[root] = num_components++;
+        component[i] = root_component[root];
+    }
+
+    free_name_table(&table);
+    free(root_component);
+    free(parent);
+    return num_components;
+}
+
+/**
+ * @brief Worker loop: takes components off the work queue and schedules them
+ *
+ * The scheduler queues are thread local, so every component run here is a
+ * simulation of its own. The resources of different components are disjoint,
+ * so the shared resource list is never written by two threads at once.
+ */
+static void *run_components(void *arg)
+{
+    partition_run_t *run = arg;
+    component_t *component;
+    pcb_t *leader;
+
+    while ((leader = lf_dequeue_pcb(&run->workq)) != NULL) {
+        component = &run->components[run->component_of[pcb_mem(leader)->number]];
+
+        log_capture_begin(&component->log);
+        init_queues(component->init.first, component->arriving.first);
+        schedule_processes(run->algorithm, run->time_quantum);
+        free_manager();
+        log_capture_end();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Appends pcb to queue, keeping load order
+ */
+static void append_pcb(pcb_queue_t *queue, pcb_t *pcb)
+{
+    pcb->next = NO_PCB;
+    if (queue->first == NULL) queue->first = pcb;
+    else queue->last->next = pcb->id;
+    queue->last = pcb;
+}
+
+/**
+ * @brief Finds the representative of the set that x belongs to
+ *
+ * Halves the path on the way up so that later lookups are shorter.
+ */
+static int find_root(int *parent, int x)
+{
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+/**
+ * @brief Merges the sets of a and b
+ */
+static void union_sets(int *parent, int a, int b)
+{
+    int root_a = find_root(parent, a);
+    int root_b = find_root(parent, b);
+
+    if (root_a < root_b) parent[root_b] = root_a;
+    else if (root_b < root_a) parent[root_a] = root_b;
+}
+
+/**
+ * @brief Initialises an empty name table, one id per string of the string
+ *        table
+ */
+void init_name_table(name_table_t *table)
+{
+    int i, size = str_count();
+
+    table->ids = malloc((size ? size : 1) * sizeof(int));
+    if (table->ids == NULL) {
+        fprintf(stderr, "Memory allocation failed for name table\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < size; i++) table->ids[i] = -1;
+    table->count = 0;
+}
+
+/**
+ * @brief Frees a name table (the names themselves belong to the string table)
+ */
+void free_name_table(name_table_t *table)
+{
+    free(table->ids);
+    table->ids = NULL;
+}
+
+/**
+ * @brief Returns the id of name, adding it to the table if it is new. The
+ *        loader interns every name, so a name the string table does not
+ *        know is reported and gets no id.
+ *
+ * @return The id, -1 for a name the loader never saw
+ */
+int name_to_id(name_table_t *table, char *name)
+{
+    int str_id = str_find(name);
+
+    if (str_id < 0) {
+        fprintf(stderr, "Error: %s is not a loaded name\n", name);
+        return -1;
+    }
+    if (table->ids[str_id] < 0) table->ids[str_id] = table->count++;
+    return table->ids[str_id];
+}
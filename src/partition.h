@@ -0,0 +1,42 @@
+/**
+ * @file partition.h
+ * @description Splitting a workload into groups of processes that can be
+ *              simulated independently.
+ */
+#ifndef _PARTITION_H
+#define _PARTITION_H
+
+#include <stddef.h>
+#include "proc_structs.h"
+#include "manager.h"
+
+/**
+ * Numbers the resource and mailbox names a pass meets densely from 0, in
+ * the order it meets them. The names are looked up in the string table of
+ * the loader, which already holds every one of them.
+ */
+typedef struct name_table_t {
+    int *ids; /* dense id by string table id, -1 if not met yet */
+    int count;
+} name_table_t;
+
+/** Initialises an empty name table for the names of the string table */
+void init_name_table(name_table_t *table);
+
+/** Returns the id of <code>name</code>, adding it if it is new; -1 if it was never loaded */
+int name_to_id(name_table_t *table, char *name);
+
+/** Frees the table (not the names, which belong to the string table) */
+void free_name_table(name_table_t *table);
+
+/** Labels the connected components of shared resources/mailboxes, returns their number */
+int label_components(pcb_t **procs, int num_procs, int *component);
+
+/**
+ * Schedules the connected components of the workload as independent
+ * simulations on worker threads.
+ */
+void schedule_partitioned(pcb_t *procs_loaded, pcb_t *procs_arriving,
+                          schedule_t algorithm, int time_quantum, int num_threads);
+
+#endif
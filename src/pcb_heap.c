@@ -0,0 +1,180 @@
+/**
+ * @file pcb_heap.c
+ * @brief An indexed binary min-heap of pcbs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "pcb_pool.h"
+#include "pcb_heap.h"
+
+#define NOT_IN_HEAP -1
+
+/* The position of a pcb in this heap */
+#define IDX(heap, pcb) (*(int *)((char *)pcb_cold(pcb) + (heap)->idx_offset))
+
+static void place(pcb_heap_t *heap, int idx, pcb_t *pcb);
+static void sift_up(pcb_heap_t *heap, int idx);
+static void sift_down(pcb_heap_t *heap, int idx);
+
+/**
+ * @brief Initialises an empty heap
+ *
+ * @param heap The heap to initialise
+ * @param before The order of the heap: the first pcb is never after another
+ */
+void init_pcb_heap(pcb_heap_t *heap, pcb_before_t before)
+{
+    init_pcb_heap_at(heap, before, offsetof(pcb_cold_t, heap_idx));
+}
+
+/**
+ * @brief Initialises an empty heap that keeps positions in another field
+ *
+ * @param heap The heap to initialise
+ * @param before The order of the heap
+ * @param idx_offset The offset of the int field of the cold part of a pcb holding its position
+ */
+void init_pcb_heap_at(pcb_heap_t *heap, pcb_before_t before, size_t idx_offset)
+{
+    heap->pcbs = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+    heap->before = before;
+    heap->idx_offset = idx_offset;
+}
+
+/**
+ * @brief Adds a pcb to the heap in O(log n)
+ */
+void pcb_heap_push(pcb_heap_t *heap, pcb_t *pcb)
+{
+    pcb_t **grown;
+
+    if (pcb == NULL) return;
+
+    if (heap->size == heap->capacity) {
+        heap->capacity = heap->capacity ? 2 * heap->capacity : 16;
+        grown = realloc(heap->pcbs, heap->capacity * sizeof(pcb_t *));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for pcb heap\n");
+            exit(EXIT_FAILURE);
+        }
+        heap->pcbs = grown;
+    }
+    place(heap, heap->size++, pcb);
+    sift_up(heap, IDX(heap, pcb));
+}
+
+/**
+ * @brief Removes the first pcb from the heap in O(log n)
+ *
+ * @return The pcb that must run first, NULL if the heap is empty
+ */
+pcb_t *pcb_heap_pop(pcb_heap_t *heap)
+{
+    pcb_t *first = pcb_heap_peek(heap);
+
+    if (first != NULL) pcb_heap_remove(heap, first);
+    return first;
+}
+
+/**
+ * @brief Returns the first pcb in O(1)
+ */
+pcb_t *pcb_heap_peek(pcb_heap_t *heap)
+{
+    return heap->size > 0 ? heap->pcbs[0] : NULL;
+}
+
+/**
+ * @brief Removes any pcb from the heap in O(log n)
+ */
+void pcb_heap_remove(pcb_heap_t *heap, pcb_t *pcb)
+{
+    int idx;
+
+    if (!pcb_heap_contains(heap, pcb)) return;
+
+    idx = IDX(heap, pcb);
+    heap->size--;
+    if (idx != heap->size) {
+        /* Move the last pcb into the hole and restore the order around it */
+        place(heap, idx, heap->pcbs[heap->size]);
+        sift_up(heap, idx);
+        sift_down(heap, idx);
+    }
+    IDX(heap, pcb) = NOT_IN_HEAP;
+}
+
+/**
+ * @brief Moves a pcb whose key changed to its new place in O(log n)
+ */
+void pcb_heap_update(pcb_heap_t *heap, pcb_t *pcb)
+{
+    int idx;
+
+    if (!pcb_heap_contains(heap, pcb)) return;
+
+    idx = IDX(heap, pcb);
+    sift_up(heap, idx);
+    sift_down(heap, idx);
+}
+
+/**
+ * @brief Returns TRUE if pcb is stored in this heap
+ */
+bool_t pcb_heap_contains(pcb_heap_t *heap, pcb_t *pcb)
+{
+    return (pcb != NULL && IDX(heap, pcb) >= 0 && IDX(heap, pcb) < heap->size
+            && heap->pcbs[IDX(heap, pcb)] == pcb) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Frees the array of the heap
+ */
+void free_pcb_heap(pcb_heap_t *heap)
+{
+    free(heap->pcbs);
+    heap->pcbs = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+}
+
+/* Stores pcb at idx and records the position in the pcb */
+static void place(pcb_heap_t *heap, int idx, pcb_t *pcb)
+{
+    heap->pcbs[idx] = pcb;
+    IDX(heap, pcb) = idx;
+}
+
+/* Moves the pcb at idx up while it must run before its parent */
+static void sift_up(pcb_heap_t *heap, int idx)
+{
+    pcb_t *pcb = heap->pcbs[idx];
+    int parent;
+
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!heap->before(pcb, heap->pcbs[parent])) break;
+        place(heap, idx, heap->pcbs[parent]);
+        idx = parent;
+    }
+    place(heap, idx, pcb);
+}
+
+/* Moves the pcb at idx down while a child must run before it */
+static void sift_down(pcb_heap_t *heap, int idx)
+{
+    pcb_t *pcb = heap->pcbs[idx];
+    int child;
+
+    for (;;) {
+        child = 2 * idx + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && heap->before(heap->pcbs[child + 1], heap->pcbs[child])) child++;
+        if (!heap->before(heap->pcbs[child], pcb)) break;
+        place(heap, idx, heap->pcbs[child]);
+        idx = child;
+    }
+    place(heap, idx, pcb);
+}
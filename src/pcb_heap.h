@@ -0,0 +1,61 @@
+/**
+ * @file pcb_heap.h
+ * @description An indexed binary heap of pcbs, used as a ready queue by the
+ *              schedulers that always run the "smallest" process first.
+ */
+#ifndef _PCB_HEAP_H
+#define _PCB_HEAP_H
+
+#include <stddef.h>
+
+#include "proc_structs.h"
+
+/** Returns TRUE if <code>a</code> must run before <code>b</code> */
+typedef bool_t (*pcb_before_t)(pcb_t *a, pcb_t *b);
+
+/**
+ * The heap stores the position of every pcb in the pcb itself (the
+ * heap_idx of its cold part), so that a pcb can be removed or re-keyed in
+ * O(log n) without searching for it. A heap that a pcb is in at the same time as
+ * another keeps the position in a field of its own.
+ */
+typedef struct pcb_heap_t {
+    pcb_t **pcbs;
+    int size;
+    int capacity;
+    pcb_before_t before;
+    size_t idx_offset; /* offset in pcb_cold_t of the position of a pcb */
+} pcb_heap_t;
+
+/** Initialises an empty heap ordered by <code>before</code> */
+void init_pcb_heap(pcb_heap_t *heap, pcb_before_t before);
+
+/**
+ * Initialises an empty heap ordered by <code>before</code> that keeps the
+ * position of a pcb in the int field at <code>idx_offset</code> of its
+ * pcb_cold_t, e.g. offsetof(pcb_cold_t, wait_idx)
+ */
+void init_pcb_heap_at(pcb_heap_t *heap, pcb_before_t before, size_t idx_offset);
+
+/** Adds <code>pcb</code> to the heap */
+void pcb_heap_push(pcb_heap_t *heap, pcb_t *pcb);
+
+/** Removes and returns the pcb that must run first, NULL if empty */
+pcb_t *pcb_heap_pop(pcb_heap_t *heap);
+
+/** Returns the pcb that must run first without removing it, NULL if empty */
+pcb_t *pcb_heap_peek(pcb_heap_t *heap);
+
+/** Removes <code>pcb</code> from wherever it is in the heap */
+void pcb_heap_remove(pcb_heap_t *heap, pcb_t *pcb);
+
+/** Restores the heap order after the key of <code>pcb</code> changed */
+void pcb_heap_update(pcb_heap_t *heap, pcb_t *pcb);
+
+/** Returns TRUE if <code>pcb</code> is in the heap */
+bool_t pcb_heap_contains(pcb_heap_t *heap, pcb_t *pcb);
+
+/** Frees the memory of the heap (not the pcbs) */
+void free_pcb_heap(pcb_heap_t *heap);
+
+#endif
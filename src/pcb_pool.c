@@ -0,0 +1,156 @@
+/**
+ * @file pcb_pool.c
+ * @brief Slab allocator for process control blocks.
+ *
+ * Slots are carved out of slabs of PCB_SLAB_SIZE, so loading a workload
+ * costs one allocation per slab instead of two per process, and the pcbs
+ * of a workload lie next to each other. A slab keeps the hot pcbs of its
+ * slots in one dense array at the start of the slab, two to a cache line,
+ * and the cold parts and process_in_mems in arrays of their own, so a walk
+ * of a queue never pulls statistics, names or programs into the cache. A
+ * slot is known by its 32-bit id, slab index * PCB_SLAB_SIZE + position,
+ * which is the PID of its pcb and also links the free list. A terminated
+ * process returns its slot to the LIFO free list, so the next allocation
+ * gets the slot that was used last and is most likely still in cache. The
+ * pool is shared by the worker threads of a partitioned run, so it has a
+ * lock; the slab index only grows while a workload is loaded, so looking an
+ * id up needs none.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "pcb_pool.h"
+
+/** Bytes of a cache line, the alignment of a slab */
+#define PCB_CACHE_LINE 64
+
+pcb_slab_t **pcb_slabs = NULL;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int num_slabs = 0;
+static unsigned int slab_capacity = 0;
+static pcb_id_t free_slots = NO_PCB;
+static size_t num_live = 0;
+
+static bool_t add_slab(void);
+
+/**
+ * @brief Takes a slot from the free list, or else from the newest slab,
+ *        adding a slab when it is full
+ *
+ * @return The pcb of the slot, its id and that of its cold part set, NULL
+ *         if out of memory
+ */
+pcb_t *alloc_pcb(void)
+{
+    pcb_slab_t *slab;
+    pcb_id_t id;
+    int i;
+
+    pthread_mutex_lock(&pool_lock);
+    if (free_slots != NO_PCB) {
+        id = free_slots;
+        slab = pcb_slabs[id / PCB_SLAB_SIZE];
+        i = id % PCB_SLAB_SIZE;
+        free_slots = slab->next_free[i];
+    } else {
+        if ((num_slabs == 0 || pcb_slabs[num_slabs - 1]->used == PCB_SLAB_SIZE) && !add_slab()) {
+            pthread_mutex_unlock(&pool_lock);
+            return NULL;
+        }
+        slab = pcb_slabs[num_slabs - 1];
+        i = slab->used++;
+        id = (num_slabs - 1) * PCB_SLAB_SIZE + i;
+    }
+    slab->live[i] = TRUE;
+    slab->hot[i].id = id;
+    slab->cold[i].id = id;
+    num_live++;
+    pthread_mutex_unlock(&pool_lock);
+    return &slab->hot[i];
+}
+
+/**
+ * @brief Puts the slot of a pcb on the free list
+ */
+void free_pcb(pcb_t *pcb)
+{
+    pcb_slab_t *slab;
+    int i;
+
+    if (pcb == NULL) return;
+    pthread_mutex_lock(&pool_lock);
+    slab = pcb_slabs[pcb->id / PCB_SLAB_SIZE];
+    i = pcb->id % PCB_SLAB_SIZE;
+    slab->live[i] = FALSE;
+    slab->next_free[i] = free_slots;
+    free_slots = pcb->id;
+    num_live--;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * @brief Calls <code>fn</code> on every live pcb, in id order
+ */
+void for_each_pcb(void (*fn)(pcb_t *pcb))
+{
+    unsigned int s;
+    int i;
+
+    for (s = 0; s < num_slabs; s++) {
+        for (i = 0; i < pcb_slabs[s]->used; i++) {
+            if (pcb_slabs[s]->live[i]) fn(&pcb_slabs[s]->hot[i]);
+        }
+    }
+}
+
+/**
+ * @brief Frees every slab, live pcbs included
+ */
+void free_pcb_pool(void)
+{
+    unsigned int s;
+
+    pthread_mutex_lock(&pool_lock);
+    for (s = 0; s < num_slabs; s++) free(pcb_slabs[s]);
+    free(pcb_slabs);
+    pcb_slabs = NULL;
+    num_slabs = slab_capacity = 0;
+    free_slots = NO_PCB;
+    num_live = 0;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * @brief Returns the number of pcbs allocated and not freed
+ */
+size_t live_pcbs(void)
+{
+    return num_live;
+}
+
+/**
+ * @brief Appends an empty, cache line aligned slab, growing the slab index
+ *        as needed; the caller holds the lock
+ *
+ * @return FALSE if out of memory or out of 32-bit ids
+ */
+static bool_t add_slab(void)
+{
+    pcb_slab_t **grown;
+    pcb_slab_t *slab;
+    size_t size = (sizeof(pcb_slab_t) + PCB_CACHE_LINE - 1) / PCB_CACHE_LINE * PCB_CACHE_LINE;
+
+    if (num_slabs >= (NO_PCB - 1) / PCB_SLAB_SIZE) return FALSE;
+    if (num_slabs == slab_capacity) {
+        grown = realloc(pcb_slabs, (slab_capacity ? 2 * slab_capacity : 16) * sizeof(pcb_slab_t *));
+        if (grown == NULL) return FALSE;
+        pcb_slabs = grown;
+        slab_capacity = slab_capacity ? 2 * slab_capacity : 16;
+    }
+    slab = aligned_alloc(PCB_CACHE_LINE, size);
+    if (slab == NULL) return FALSE;
+    slab->used = 0;
+    pcb_slabs[num_slabs++] = slab;
+    return TRUE;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file pcb_pool.h
+ * @description Slab allocator for process control blocks, and the tables
+ *              that map a pcb id to the parts of its pcb. A slot holds a
+ *              hot pcb_t, a pcb_cold_t and a process_in_mem, each in an
+ *              array of its own; freed slots are kept on a free list and
+ *              handed out again before any new slab is allocated.
+ */
+#ifndef _PCB_POOL_H
+#define _PCB_POOL_H
+
+#include <stddef.h>
+#include "proc_structs.h"
+
+/** Slots per slab, a power of two */
+#ifndef PCB_SLAB_SIZE
+#define PCB_SLAB_SIZE 64
+#endif
+
+/** The slots of a slab: slot i of slab s has id s * PCB_SLAB_SIZE + i */
+typedef struct pcb_slab_t {
+    pcb_t hot[PCB_SLAB_SIZE]; /* first, the slab is cache line aligned */
+    pcb_cold_t cold[PCB_SLAB_SIZE];
+    process_in_mem_t mems[PCB_SLAB_SIZE];
+    pcb_id_t next_free[PCB_SLAB_SIZE]; /* slot after each free slot */
+    bool_t live[PCB_SLAB_SIZE];
+    int used; /* slots handed out at least once */
+} pcb_slab_t;
+
+/** The slabs by slab index; only grows while a workload is loaded */
+extern pcb_slab_t **pcb_slabs;
+
+/** Returns the pcb with id <code>id</code>, NULL for NO_PCB */
+static inline pcb_t *pcb_at(pcb_id_t id)
+{
+    return id == NO_PCB ? NULL : &pcb_slabs[id / PCB_SLAB_SIZE]->hot[id % PCB_SLAB_SIZE];
+}
+
+/** Returns the id of <code>pcb</code>, NO_PCB for NULL */
+static inline pcb_id_t pcb_id(const pcb_t *pcb)
+{
+    return pcb == NULL ? NO_PCB : pcb->id;
+}
+
+/** Returns the pcb after <code>pcb</code> in its queue or list, NULL if last */
+static inline pcb_t *pcb_next(const pcb_t *pcb)
+{
+    return pcb_at(pcb->next);
+}
+
+/** Returns the cold part of <code>pcb</code> */
+static inline pcb_cold_t *pcb_cold(const pcb_t *pcb)
+{
+    return &pcb_slabs[pcb->id / PCB_SLAB_SIZE]->cold[pcb->id % PCB_SLAB_SIZE];
+}
+
+/** Returns the name and instructions of <code>pcb</code> */
+static inline process_in_mem_t *pcb_mem(const pcb_t *pcb)
+{
+    return &pcb_slabs[pcb->id / PCB_SLAB_SIZE]->mems[pcb->id % PCB_SLAB_SIZE];
+}
+
+/**
+ * Returns an uninitialised pcb whose id, and that of its cold part, is its
+ * slot, NULL if out of memory.
+ */
+pcb_t *alloc_pcb(void);
+
+/** Returns the slot of <code>pcb</code> to the pool */
+void free_pcb(pcb_t *pcb);
+
+/** Calls <code>fn</code> on every pcb that was allocated and not freed */
+void for_each_pcb(void (*fn)(pcb_t *pcb));
+
+/** Frees every slab; all pcbs become invalid */
+void free_pcb_pool(void);
+
+/** Returns the number of pcbs allocated and not freed */
+size_t live_pcbs(void);
+
+#endif
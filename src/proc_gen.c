@@ -75,6 +75,7 @@ bool_t gen_init_proc_list(bool_t priority_sched) {
         if (priority_sched) proc_priority = gen_prio(priorities_allocated, i);
         success = load_process(name, proc_priority);
         gen_instrs(name);
+        free(name); /* the loader keeps a copy */
     }
 
     /* Generate and load a list of resources */
@@ -85,6 +86,7 @@ bool_t gen_init_proc_list(bool_t priority_sched) {
         if (duplicate) name = gen_name('R', i);
         else name = gen_name('R', i + 1);
         success = load_resource(name);
+        free(name);
     }
 
     /* Generate and load a list of mailboxes */
@@ -94,6 +96,7 @@ bool_t gen_init_proc_list(bool_t priority_sched) {
         for(i = 0; i < num_mailboxes; i++) {
             name = gen_name('m', i);
             success = load_mailbox(name);
+            free(name);
         }
     }
 
@@ -121,6 +124,7 @@ bool_t gen_new_proc_list(bool_t priority_sched) {
         if (priority_sched) proc_priority = gen_prio(priorities_allocated, i);
         success = load_process(name, proc_priority);
         gen_instrs(name);
+        free(name); /* the loader keeps a copy */
     }
     
     return success;
@@ -136,7 +140,7 @@ bool_t gen_new_proc_list(bool_t priority_sched) {
  *
  */
 void gen_instrs(char *process_name) {
-    char *name;
+    char *name, *msg;
 
     for (int i = 0; i < num_instructions; i++) {
         int instruction = random() % SUPPORTED_INSTR;
@@ -144,7 +148,10 @@ void gen_instrs(char *process_name) {
             case SEND_OP:
             case RECV_OP:
                 name = gen_name('m', rand() % num_mailboxes);
-                load_instruction(process_name, instruction, name, gen_msg(name));
+                msg = gen_msg(name);
+                load_instruction(process_name, instruction, name, msg);
+                free(msg);
+                free(name);
                 break;
             case REQ_OP:  
                 name = gen_name('R', rand() % num_resources);
@@ -154,10 +161,12 @@ void gen_instrs(char *process_name) {
                     load_instruction(process_name, REL_OP, name, NULL);
                 }
                 #endif
+                free(name);
                 break;
             case REL_OP:  
                 name = gen_name('R', rand() & num_resources);
                 load_instruction(process_name, instruction, name, NULL);
+                free(name);
             default: 
                 break;
         }
@@ -6,13 +6,17 @@
 #include "proc_structs.h"
 #include "proc_gen.h"
 #include "proc_syntax.h"
+#include "pcb_pool.h"
+#include "str_table.h"
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-void dealloc_process_in_mem(process_in_mem_t *p);
 void dealloc_resource_list(resource_t *r);
+void index_resource_set(instr_t *instr);
+resource_t *load_parent(char *resource_name, size_t len);
 void dealloc_mailboxes();
 void dealloc_data_structures();
 
@@ -22,6 +26,8 @@ void print_mailbox_list();
 void print_instr_list(char *msg, instr_t *nxt_instr);
 
 void add_to_pcb_list(pcb_t *pcb); 
+static int intern_name(const char *name);
+static int resource_id_of(const char *name);
 char *last_proc_name = "";
 int last_proc_num = 0;
 
@@ -31,16 +37,29 @@ pcb_t *last_pcb = NULL;
 resource_t *first_resource = NULL;
 resource_t *last_resource = NULL;
 
+/* The resources by id, so that an instruction finds its resource in O(1) */
+static resource_t **resource_table = NULL;
+static int num_resources = 0;
+
 instr_t *first_instruction = NULL;
 instr_t *last_instruction = NULL;
 
 mailbox_t *first_mailbox = NULL;
 mailbox_t *last_mailbox = NULL;
 
+/* What each name in the string table names, by string id, so that the
+   loader finds a process or a resource by name in O(1) */
+typedef struct name_ref_t {
+    int resource; /* id of the resource of that name, -1 if none */
+    pcb_t *pcb; /* the process of that name in the list being loaded, NULL if none */
+} name_ref_t;
+
+static name_ref_t *name_refs = NULL;
+static int name_ref_capacity = 0;
+
 void init_loader()
 {
-    last_proc_name = malloc(sizeof(char));
-    last_proc_name[0] = '\0';
+    last_proc_name = "";
 }
 
 /**
@@ -64,6 +83,10 @@ struct pcb_t *init_loader_from_files(char *filename1, char *filename2) {
     print_pcb_list("Arrival processes");
     print_resource_list();
 
+    index_resources(init_procs);
+    index_resources(first_pcb);
+    compute_resource_ceilings(init_procs);
+    compute_resource_ceilings(first_pcb);
     return init_procs;
 }
 
@@ -90,6 +113,11 @@ struct pcb_t *init_loader_from_generator() {
     print_pcb_list("Arrival processes");
     print_resource_list();
 
+    index_resources(init_pcbs);
+    index_resources(first_pcb);
+    compute_resource_ceilings(init_pcbs);
+    compute_resource_ceilings(first_pcb);
+
     return init_pcbs; 
 }
 
@@ -101,17 +129,12 @@ struct pcb_t *init_loader_from_generator() {
  * @param the pcb to add
  */
 void add_to_pcb_list(pcb_t *new_pcb) {
-    pcb_t *current_pcb;
-
     if (first_pcb == NULL) {
         first_pcb = new_pcb;
     } else {
-        current_pcb = first_pcb;
-        while (current_pcb->next != NULL) {
-            current_pcb = current_pcb->next; 
-        }
-        current_pcb->next = new_pcb;
+        last_pcb->next = new_pcb->id;
     }
+    last_pcb = new_pcb;
 
     #ifdef DEBUG_LOADER
         print_pcb_list("Loaded"); 
@@ -126,37 +149,158 @@ void add_to_pcb_list(pcb_t *new_pcb) {
  * loaded from the process.list file. It initialises a number of pointers to
  * NULL as well as setting the processState to NEW. 
  *
- * \param process_name The name of the new process to load
+ * \param process_name The name of the new process to load, copied to the
+ *        string table
  */
 bool_t load_process(char* process_name, int priority) {
-    process_in_mem_t *new_process_in_mem = malloc(sizeof(process_in_mem_t));
+    pcb_t *pcb = alloc_pcb(); /* with its cold part and process_in_mem */
+    pcb_cold_t *cold;
+    int name_id;
 
-    pcb_t *pcb = NULL;
-    if (new_process_in_mem) {
-        pcb = malloc(sizeof(pcb_t));
-        pcb->process_in_mem = new_process_in_mem;
+    if (pcb) {
+        cold = pcb_cold(pcb);
         pcb->state = NEW;
         pcb->next_instruction = NULL;
         pcb->priority = priority;
-        pcb->resources = NULL;
-        pcb->next = NULL;
-
-        pcb->process_in_mem->name = process_name;
-        pcb->process_in_mem->number = ++last_proc_num;
+        pcb->prev = NO_PCB;
+        pcb->next = NO_PCB;
+
+        cold->base_priority = priority;
+        cold->resources = NULL;
+        cold->blocked_on = NULL;
+        cold->remaining = 0;
+        cold->ready_seq = 0;
+        cold->heap_idx = -1;
+        cold->wait_idx = -1;
+        cold->fifo_idx = -1;
+        cold->vruntime = 0;
+        cold->release = 0;
+        cold->abs_deadline = LONG_MAX;
+        cold->jobs = 0;
+        cold->deadline_misses = 0;
+        cold->max_lateness = LONG_MIN;
+        cold->age_key = 0;
+        cold->wait_until = 0;
+        cold->writer_waiting = FALSE;
+
+        name_id = intern_name(process_name);
+        pcb_mem(pcb)->name = str_at(name_id);
+        pcb_mem(pcb)->number = ++last_proc_num;
+        pcb_mem(pcb)->first_instr = NULL;
+        pcb_mem(pcb)->period = 0;
+        pcb_mem(pcb)->deadline = 0;
+        pcb_mem(pcb)->wcet = 0;
 
         add_to_pcb_list(pcb);
+        /* The first process of a name gets its instructions */
+        if (name_refs[name_id].pcb == NULL) name_refs[name_id].pcb = pcb;
     } 
     
     if (pcb) return TRUE;
     else return FALSE;
 }
 
+/**
+ * @brief Sets the timing attributes of a periodic process.
+ *
+ * A periodic process without a deadline has its period as deadline.
+ *
+ * @param process_name The name of the process
+ * @param period The time between two releases, 0 if not periodic
+ * @param deadline The relative deadline of every job, 0 if none
+ * @param wcet The declared worst case execution time, 0 if not declared
+ *
+ * @return TRUE if the process was found
+ */
+bool_t load_timing(char *process_name, int period, int deadline, int wcet) {
+    int name_id = str_find(process_name);
+    pcb_t *pcb = (name_id >= 0) ? name_refs[name_id].pcb : NULL;
+
+    if (pcb == NULL) return FALSE;
+    pcb_mem(pcb)->period = period;
+    pcb_mem(pcb)->deadline = (deadline == 0) ? period : deadline;
+    pcb_mem(pcb)->wcet = wcet;
+    return TRUE;
+}
+
+/**
+ * @brief Looks up the resource of every request and release instruction of
+ *        the processes in the list, once, so that the scheduler never
+ *        compares resource names.
+ *
+ * @param pcbs The list of processes
+ */
+void index_resources(pcb_t *pcbs) {
+    pcb_t *pcb;
+    instr_t *instr;
+
+    for (pcb = pcbs; pcb != NULL; pcb = pcb_next(pcb)) {
+        for (instr = pcb_mem(pcb)->first_instr; instr != NULL; instr = instr->next) {
+            instr->resource_id = -1;
+            if (instr->type != REQ_OP && instr->type != REL_OP) continue;
+            instr->resource_id = resource_id_of(instr->resource_name);
+            if (instr->set_size > 0) index_resource_set(instr);
+        }
+    }
+}
+
+/**
+ * @brief Looks up the resources of a multi-resource request and builds its
+ *        bitmap. A request that names an undeclared resource gets the
+ *        resource id -1: it can never be granted.
+ */
+void index_resource_set(instr_t *instr) {
+    int i, id;
+    size_t words = (num_resources + RESOURCE_BITS - 1) / RESOURCE_BITS;
+
+    free(instr->set_ids);
+    free(instr->set_mask);
+    instr->set_ids = malloc(instr->set_size * sizeof(int));
+    instr->set_mask = calloc(words ? words : 1, sizeof(unsigned long));
+    if (instr->set_ids == NULL || instr->set_mask == NULL) {
+        fprintf(stderr, "Memory allocation failed for resource set\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < instr->set_size; i++) {
+        id = resource_id_of(instr->set_names[i]);
+        instr->set_ids[i] = id;
+        if (id < 0) instr->resource_id = -1;
+        else instr->set_mask[id / RESOURCE_BITS] |= 1UL << (id % RESOURCE_BITS);
+    }
+}
+
+/**
+ * @brief Raises the ceiling of every resource to the highest priority of the
+ *        processes in the list that request it.
+ *
+ * @param pcbs The list of processes, indexed by index_resources()
+ */
+void compute_resource_ceilings(pcb_t *pcbs) {
+    pcb_t *pcb;
+    instr_t *instr;
+    resource_t *resource;
+
+    int i;
+
+    for (pcb = pcbs; pcb != NULL; pcb = pcb_next(pcb)) {
+        for (instr = pcb_mem(pcb)->first_instr; instr != NULL; instr = instr->next) {
+            if (instr->type != REQ_OP) continue;
+            for (i = 0; i < (instr->set_size ? instr->set_size : 1); i++) {
+                resource = get_resource(instr->set_size ? instr->set_ids[i] : instr->resource_id);
+                if (resource && pcb_cold(pcb)->base_priority > resource->ceiling) resource->ceiling = pcb_cold(pcb)->base_priority;
+            }
+        }
+    }
+}
+
 /**
  * @brief Loads the mailbox from the process.list file.
  *
  * Loads a mailbox resource and adds it to the list of mailboxes. 
  *
- * @param mailbox_name The name of the mailbox to load.
+ * @param mailbox_name The name of the mailbox to load, copied to the string
+ *        table.
  */
 bool_t load_mailbox(char* mailbox_name) {
     mailbox_t *tmp_mailbox = malloc(sizeof(mailbox_t));
@@ -171,7 +315,8 @@ bool_t load_mailbox(char* mailbox_name) {
             last_mailbox->next = tmp_mailbox;
             last_mailbox = tmp_mailbox;
         }
-        last_mailbox->name = mailbox_name;
+        last_mailbox->name = str_at(intern_name(mailbox_name));
+        last_mailbox->msg = NULL;
         last_mailbox->next = NULL;
     } else {
         success = FALSE;
@@ -189,15 +334,33 @@ bool_t load_mailbox(char* mailbox_name) {
  * @brief Loads a resource from the process.list file.
  *
  * Loads a resource and adds it to the list of resources. The resource
- * is indicated as available and the resource name is stored.
+ * is indicated as available and the resource name is stored. A resource
+ * that is already loaded (both files may list it) is loaded only once.
+ * A resource named by a path, e.g. DB/T1/R7, is part of the resource
+ * named by the path up to its last slash, which is loaded first.
  *
- * @param resource_name The name of the resource to load.
+ * @param resource_name The name of the resource to load, copied to the
+ *        string table.
  */
 bool_t load_resource(char *resource_name) {
-    resource_t *tmp_resource = malloc(sizeof(resource_t));
+    resource_t *tmp_resource;
+    resource_t *parent = NULL;
+    resource_t **grown;
+    char *slash;
     bool_t success = TRUE;  
+    int name_id = intern_name(resource_name);
+
+    if (name_refs[name_id].resource >= 0) return TRUE;
+    resource_name = str_at(name_id);
+
+    slash = strrchr(resource_name, SLASH);
+    if (slash != NULL && slash != resource_name) parent = load_parent(resource_name, slash - resource_name);
+
+    tmp_resource = malloc(sizeof(resource_t));
+    grown = realloc(resource_table, (num_resources + 1) * sizeof(resource_t *));
+    if (grown) resource_table = grown;
  
-    if (tmp_resource) {
+    if (tmp_resource && grown) {
         if (first_resource == NULL) {
             first_resource = tmp_resource; 
             last_resource = first_resource;
@@ -207,8 +370,20 @@ bool_t load_resource(char *resource_name) {
         }
         last_resource->name = resource_name;
         last_resource->available = YES;
+        last_resource->holder = NULL;
+        last_resource->readers = 0;
+        last_resource->writers_waiting = 0;
+        last_resource->shared = FALSE;
+        last_resource->parent = parent;
+        last_resource->intent_shared = 0;
+        last_resource->intent_exclusive = 0;
+        last_resource->ceiling = -1;
         last_resource->next = NULL;
+        last_resource->id = num_resources;
+        resource_table[num_resources++] = last_resource;
+        name_refs[name_id].resource = last_resource->id;
     } else {
+        free(tmp_resource);
         success = FALSE;
     }
 #ifdef DEBUG_LOADER
@@ -220,6 +395,19 @@ bool_t load_resource(char *resource_name) {
 
 }
 
+/**
+ * @brief Loads the parent of a resource in a hierarchy, named by the first
+ *        <code>len</code> characters of the name of the resource.
+ *
+ * @return The parent, NULL if it could not be loaded
+ */
+resource_t *load_parent(char *resource_name, size_t len) {
+    int name_id = str_intern(resource_name, len);
+
+    if (name_id < 0 || !load_resource(str_at(name_id))) return NULL;
+    return get_resource(name_refs[name_id].resource);
+}
+
 /**
  * @brief Loads an instruction for a process.
  *
@@ -231,6 +419,8 @@ bool_t load_resource(char *resource_name) {
  * instruction.
  * @param resource_name The name of the resource used in the instruction.
  * @param instruction Indicates the next request, release or message to send.
+ *
+ * The names and the message are copied to the string table.
  */
 bool_t load_instruction(char *process_name, instr_types_t instruction, 
     char *resource_name, char *msg) {
@@ -238,6 +428,7 @@ bool_t load_instruction(char *process_name, instr_types_t instruction,
 
     instr_t *tmp_instr = malloc(sizeof(struct instr_t));
     pcb_t *pcb = NULL;
+    int name_id;
 
     if (tmp_instr) { 
         if (strcmp(last_proc_name, process_name) != 0) {
@@ -250,12 +441,19 @@ bool_t load_instruction(char *process_name, instr_types_t instruction,
             last_instruction = tmp_instr;
         }
     
-        last_instruction->resource_name = resource_name;
+        last_instruction->resource_name = str_at(intern_name(resource_name));
+        last_instruction->resource_id = -1;
+        last_instruction->set_size = 0;
+        last_instruction->set_names = NULL;
+        last_instruction->set_ids = NULL;
+        last_instruction->set_mask = NULL;
+        last_instruction->timeout = NO_TIMEOUT;
+        last_instruction->shared = FALSE;
         switch (instruction) {
         case SEND_OP: 
         case RECV_OP: 
             last_instruction->type = instruction; 
-            last_instruction->msg = msg;
+            last_instruction->msg = msg ? str_at(intern_name(msg)) : NULL;
             break;
         default: 
             last_instruction->type = instruction;
@@ -263,14 +461,13 @@ bool_t load_instruction(char *process_name, instr_types_t instruction,
             break;
         }
 
-        pcb = first_pcb;
+        name_id = intern_name(process_name);
+        process_name = str_at(name_id);
+        pcb = name_refs[name_id].pcb;
         if (pcb != NULL) {
-            do { 
-                if(strcmp(pcb->process_in_mem->name, process_name) == 0) break;
-                pcb = pcb->next;
-            } while (pcb != NULL); 
             pcb->next_instruction = first_instruction;
-            pcb->process_in_mem->first_instr = first_instruction;
+            pcb_mem(pcb)->first_instr = first_instruction;
+            pcb_cold(pcb)->remaining++;
         }
         last_proc_name = process_name; 
     } else {
@@ -280,6 +477,46 @@ bool_t load_instruction(char *process_name, instr_types_t instruction,
     return success;
 }
 
+/**
+ * @brief Makes the last loaded instruction a request of a set of resources,
+ *        that is granted all at once or not at all.
+ *
+ * @param resource_names The resources, the first is the resource_name of the
+ *        instruction. The array is handed over to the instruction and the
+ *        names in it are replaced by their copies in the string table.
+ * @param count The number of resources
+ */
+bool_t load_resource_set(char **resource_names, int count) {
+    if (last_instruction == NULL || last_instruction->type != REQ_OP || count < 2) return FALSE;
+
+    for (int i = 0; i < count; i++) resource_names[i] = str_at(intern_name(resource_names[i]));
+    last_instruction->set_names = resource_names;
+    last_instruction->set_size = count;
+    return TRUE;
+}
+
+/**
+ * @brief Makes the last loaded instruction a request that gives up when it
+ *        has waited <code>ticks</code> for its resources, at once if 0.
+ */
+bool_t load_request_timeout(int ticks) {
+    if (last_instruction == NULL || last_instruction->type != REQ_OP || ticks < 0) return FALSE;
+
+    last_instruction->timeout = ticks;
+    return TRUE;
+}
+
+/**
+ * @brief Makes the last loaded instruction a request in shared mode: the
+ *        resources can be held by several such requests at a time.
+ */
+bool_t load_request_shared() {
+    if (last_instruction == NULL || last_instruction->type != REQ_OP) return FALSE;
+
+    last_instruction->shared = TRUE;
+    return TRUE;
+}
+
 /**
  * @brief Returns a pointer to the linked list of all loaded processes.
  * 
@@ -289,9 +526,24 @@ pcb_t *get_init_pcbs() {
     pcb_t *loaded_pcbs = first_pcb;
     first_pcb = NULL;
     last_pcb = NULL;
+    /* The names of the next list name its own processes */
+    for (int i = 0; i < name_ref_capacity; i++) name_refs[i].pcb = NULL;
     return loaded_pcbs;
 }
 
+/**
+ * @brief Returns the linked list of processes that arrive during scheduling.
+ *
+ * Must be called after get_init_pcbs(): the loader list then only holds the
+ * processes of the second file (or generated arrivals). The list is handed
+ * over to the caller.
+ *
+ * @return Pointer to the first arriving pcb
+ */
+pcb_t *get_arrival_pcbs() {
+    return get_init_pcbs();
+}
+
 /**
  * @brief Remove the first pcb from the linked list of loaded processes and return it 
  * 
@@ -301,8 +553,9 @@ pcb_t *get_new_pcb() {
 
     pcb_t *new_pcb = first_pcb;
     if (new_pcb) { /* at least one pcb left */
-        first_pcb = first_pcb->next;
-        new_pcb->next = NULL;
+        first_pcb = pcb_next(first_pcb);
+        new_pcb->next = NO_PCB;
+        if (first_pcb == NULL) last_pcb = NULL;
     } else { /* pcb list empty */ 
         last_pcb = NULL;
     }
@@ -320,6 +573,22 @@ struct resource_t *get_available_resources() {
     return first_resource;
 }
 
+/**
+ * @brief Returns the resource with id <code>id</code> in O(1).
+ *
+ * @return The resource, NULL if no resource has this id
+ */
+struct resource_t *get_resource(int id) {
+    return (id >= 0 && id < num_resources) ? resource_table[id] : NULL;
+}
+
+/**
+ * @brief Returns the number of loaded resources.
+ */
+int get_num_resources() {
+    return num_resources;
+}
+
 /**
  * @brief Returns the first pointer to the available mailboxes.
  *
@@ -339,18 +608,6 @@ struct mailbox_t* get_mailboxes() {
 int get_num_procs() {
     return last_proc_num;
 }
-/**
- * @brief Frees the allocated memory for the process_in_mem struct.
- *
- * Frees the name stored in the structed followed by the struct.
- */
-void dealloc_process_in_mem(struct process_in_mem_t *p) {
-    if (p != NULL) {
-        free(p->name);
-        free(p);
-    }
-}
-
 /**
  * @brief Frees the allocated memory for the instruction struct.
  *
@@ -358,6 +615,10 @@ void dealloc_process_in_mem(struct process_in_mem_t *p) {
  */
 void dealloc_instruction(struct instr_t *i) {
     if(i != NULL) {
+        /* The names themselves are in the string table */
+        free(i->set_names);
+        free(i->set_ids);
+        free(i->set_mask);
         free(i);
     }
 }
@@ -389,27 +650,31 @@ void dealloc_resource_list(resource_t *r) {
  */
 void dealloc_pcb_list(pcb_t *current_pcb) {    
     pcb_t *next_pcb;
-    instr_t *instruction;
-    instr_t *next_instruction;
-
-    if (current_pcb != NULL) {
-
-        do {
-            instruction = current_pcb->process_in_mem->first_instr;
 
-            while (instruction != NULL) {
-                next_instruction = instruction->next;
-                dealloc_instruction(instruction);
-                instruction = next_instruction;
-            }
+    while (current_pcb != NULL) {
+        next_pcb = pcb_next(current_pcb);
+        dealloc_pcb(current_pcb);
+        current_pcb = next_pcb;
+    }
+}
 
-            dealloc_process_in_mem(current_pcb->process_in_mem);
+/**
+ * @brief Frees the instructions and holds of a process and returns its pcb
+ *        to the pool, where the next process loaded can reuse it.
+ */
+void dealloc_pcb(pcb_t *pcb) {
+    instr_t *instruction;
+    instr_t *next_instruction;
 
-            next_pcb = current_pcb->next;
-            free(current_pcb);
-            current_pcb = next_pcb;
-        } while(current_pcb != NULL);
+    instruction = pcb_mem(pcb)->first_instr;
+    while (instruction != NULL) {
+        next_instruction = instruction->next;
+        dealloc_instruction(instruction);
+        instruction = next_instruction;
     }
+    /* The holds of a process that never terminated */
+    dealloc_resource_list(pcb_cold(pcb)->resources);
+    free_pcb(pcb);
 }
 
 
@@ -425,7 +690,6 @@ void dealloc_mailboxes() {
     current_mailbox = get_mailboxes();
     if(current_mailbox != NULL) {
         do {
-            free(current_mailbox->name);
             if(current_mailbox->msg != NULL) {
                 free(current_mailbox->msg);
             }
@@ -442,40 +706,46 @@ void dealloc_mailboxes() {
  */
 void dealloc_data_structures() {
     resource_t *availableResources;
-    pcb_t *pcbs;
 
     /* Frees the memory for resources not assigned to processes */
     availableResources = get_available_resources();
     dealloc_resource_list(availableResources);
-    pcbs = first_pcb;
-    dealloc_pcb_list(pcbs);
+    free(resource_table);
+    /* Every pcb not recycled yet, wherever the scheduler left it */
+    for_each_pcb(dealloc_pcb);
+    free_pcb_pool();
     dealloc_mailboxes();
+    free(name_refs);
+    name_refs = NULL;
+    name_ref_capacity = 0;
+    free_str_table();
 }
 
 /**
- * @brief Frees the allocated memory for the process_in_mem struct.
+ * @brief Forgets the process of the last instruction loaded, so that the
+ *        next file starts a new instruction list.
  */
 void dealloc_last_proc_name() {
-    free(last_proc_name);
+    last_proc_name = "";
 }
 
 void print_pcb_list(char *msg) {
     pcb_t *current_pcb = first_pcb;
     printf("%s: ", msg);
-    do {
-        printf("%s (%d) ", current_pcb->process_in_mem->name, current_pcb->priority);
-        current_pcb = current_pcb->next;
-    } while(current_pcb != NULL);
+    while (current_pcb != NULL) {
+        printf("%s (%d) ", pcb_mem(current_pcb)->name, current_pcb->priority);
+        current_pcb = pcb_next(current_pcb);
+    }
     printf("\n");
 }
 
 void print_resource_list() {
     resource_t *current_resource = first_resource;
     printf("Resources: ");
-    do {
+    while (current_resource != NULL) {
         printf("%s ", current_resource->name);
         current_resource = current_resource->next;
-    } while(current_resource != NULL);
+    }
     printf("\n");
 }
 
@@ -483,10 +753,10 @@ void print_mailbox_list() {
     mailbox_t *current_mailbox;
     current_mailbox = first_mailbox;
     printf("mailboxes : ");
-    do {
+    while (current_mailbox != NULL) {
         printf("%s ", current_mailbox->name);
         current_mailbox = current_mailbox->next;
-    } while(current_mailbox != NULL);
+    }
     printf("\n");
 }
 
@@ -500,3 +770,43 @@ void print_instr_list(char *msg, instr_t *nxt_instr) {
     } 
     printf("\n");
 } 
+
+/**
+ * @brief Copies a name to the string table and makes room for what it
+ *        names; exits when out of memory, as the workload cannot be loaded
+ *
+ * @return The id of the name
+ */
+static int intern_name(const char *name) {
+    name_ref_t *grown;
+    int id = str_intern(name, strlen(name));
+    int capacity = name_ref_capacity ? name_ref_capacity : 64;
+
+    if (id >= 0 && id >= name_ref_capacity) {
+        while (capacity <= id) capacity *= 2;
+        grown = realloc(name_refs, capacity * sizeof(name_ref_t));
+        if (grown == NULL) id = -1;
+        else {
+            for (; name_ref_capacity < capacity; name_ref_capacity++) {
+                grown[name_ref_capacity].resource = -1;
+                grown[name_ref_capacity].pcb = NULL;
+            }
+            name_refs = grown;
+        }
+    }
+    if (id < 0) {
+        fprintf(stderr, "Memory allocation failed for name %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return id;
+}
+
+/**
+ * @brief Returns the id of the resource named <code>name</code>, -1 if no
+ *        resource has that name
+ */
+static int resource_id_of(const char *name) {
+    int name_id = str_find(name);
+
+    return (name_id >= 0 && name_id < name_ref_capacity) ? name_refs[name_id].resource : -1;
+}
@@ -10,23 +10,32 @@
 #include "proc_syntax.h"
 #include "proc_parser.h" 
 #include "proc_structs.h"
+#include "str_table.h"
 
 #define READING 0
 #define END_OF_FILE 2
-#define NAME_SZ 5
+/* Longest word of a process file, a longer one is cut */
+#define TOKEN_SZ 256
+/* Longest message of a send or receive instruction */
+#define MSG_SZ 128
+/* Most digits of a priority */
+#define PRIORITY_DIGITS 4
 
 FILE *open_process_file(char *filename);
 bool_t read_processes(FILE *fptr, char *line);
 bool_t read_resources(FILE *fptr, char *line);
 bool_t read_mailboxes(FILE *fptr, char *line);
 int read_process(FILE *fptr, char *line);
-void read_req_resource(FILE *fptr, char *line);
+int read_req_resource(FILE *fptr, char *line);
+void read_req_arguments(FILE *fptr, char *resource_name, bool_t try_only);
 void read_rel_resource(FILE *fptr, char *line);
-char *read_comms_send(FILE *fptr, char *line);
-char *read_comms_recv(FILE *fptr, char *line);
-int read_string(FILE *fptr, char *line);
+void read_comms_send(FILE *fptr, char *line, char *message);
+void read_comms_recv(FILE *fptr, char *line, char *message);
+int read_string(FILE *fptr, char *line, size_t size);
+int read_char(FILE *fptr);
 unsigned short int read_number(FILE *fptr, int *number);
 bool_t str_to_priority(char *string, int *priority);
+void str_to_timing(char *string, int *period, int *deadline, int *wcet);
 
 /**
  * @brief Reads in a specified file, parse it and store it in the associated data-structure.
@@ -40,7 +49,7 @@ bool_t str_to_priority(char *string, int *priority);
  */
 int parse_process_file(char *filename) {
     FILE *fptr = NULL;
-    char line[1024];
+    char line[TOKEN_SZ];
     int status;
     int success = FALSE;
 
@@ -53,12 +62,12 @@ int parse_process_file(char *filename) {
 
         init_loader();
     
-        read_string(fptr, line);
-        if (read_processes(fptr, line)) read_string(fptr, line);
-        if (read_resources(fptr, line)) read_string(fptr, line);
-        if (read_mailboxes(fptr, line)) read_string(fptr, line); 
+        read_string(fptr, line, TOKEN_SZ);
+        if (read_processes(fptr, line)) read_string(fptr, line, TOKEN_SZ);
+        if (read_resources(fptr, line)) read_string(fptr, line, TOKEN_SZ);
+        if (read_mailboxes(fptr, line)) read_string(fptr, line, TOKEN_SZ); 
         /* Skip all the whitespaces of the next line */
-        if (strcmp(line, "") == 0) read_string(fptr, line);
+        if (strcmp(line, "") == 0) read_string(fptr, line, TOKEN_SZ);
 
         /* Read the list of instructions listed for each process */
         status = READING;
@@ -128,7 +137,7 @@ bool_t str_to_priority(char *string, int *priority)
 {
     bool_t success = TRUE;
 
-    if ((isdigit(string[0]) && strlen(string) < NAME_SZ)) *priority = atoi(string);
+    if ((isdigit((unsigned char)string[0]) && strlen(string) <= PRIORITY_DIGITS)) *priority = atoi(string);
     else {
         printf("Priority to high %s\n", string); 
         success = FALSE; 
@@ -137,6 +146,31 @@ bool_t str_to_priority(char *string, int *priority)
     return success;
 }
 
+/**
+ * @brief Reads a timing attribute of a periodic process
+ *
+ * The attribute is written as key=value, where key is period, deadline or
+ * wcet and value is a number of ticks.
+ *
+ * @param string The attribute
+ * @param period Set if string is a period
+ * @param deadline Set if string is a deadline
+ * @param wcet Set if string is a worst case execution time
+ */
+void str_to_timing(char *string, int *period, int *deadline, int *wcet)
+{
+    char *value = strchr(string, EQUALS);
+    size_t key_len = value - string;
+    int *attribute = NULL;
+
+    if (key_len == strlen(PERIOD) && strncmp(string, PERIOD, key_len) == 0) attribute = period;
+    else if (key_len == strlen(DEADLINE) && strncmp(string, DEADLINE, key_len) == 0) attribute = deadline;
+    else if (key_len == strlen(WCET) && strncmp(string, WCET, key_len) == 0) attribute = wcet;
+
+    if (attribute != NULL && isdigit((unsigned char)value[1])) *attribute = atoi(value + 1);
+    else printf("Unknown process attribute %s\n", string);
+}
+
 /**
  * @brief Reads the list of processes and loads it with functions defined in 
  *     data_structs.h
@@ -148,40 +182,47 @@ bool_t str_to_priority(char *string, int *priority)
  * Custom change: Reads in prioriy. Unfortunately segfaults if priority is not
  * present (but it was promised to always be present).    
  *
+ * A priority may be followed by the timing attributes of a periodic process,
+ * e.g. <code>P1 2 period=10 deadline=8 wcet=3</code>.
+ *
  * @param fptr A pointer to the file from which to read.
  * @param line A pointer to a string read from the file.
  */
 bool_t read_processes(FILE *fptr, char *line) {
-    char *process_name, *nxt_string;
-    int priority, not_eol;
+    char process_name[TOKEN_SZ], nxt_string[TOKEN_SZ];
+    int priority, period, deadline, wcet, not_eol;
     bool_t success = TRUE;
 
     /* If process list provided */
     if (strcmp(line, PROCESSES) == 0) {
         /* Read next string: process name */ 
-        process_name = malloc(NAME_SZ * sizeof(char));
-        not_eol = read_string(fptr, process_name);
-        while (not_eol) {
+        not_eol = read_string(fptr, process_name, TOKEN_SZ);
+        while (not_eol == 1) {
             priority = 0;
+            period = deadline = wcet = 0;
            /* Read next string: priority or next process name */ 
-            nxt_string = malloc(NAME_SZ * sizeof(char));
-            not_eol = read_string(fptr, nxt_string); 
-            if (nxt_string != NULL) {
-               /* If string read was a priority: assign to variable */ 
-                if (str_to_priority(nxt_string, &priority)) {
-                    /* If string read was not the end of the line */
-                    if (not_eol) { 
-                        /* Read next string: process name */ 
-                        nxt_string = malloc(NAME_SZ * sizeof(char));
-                        not_eol = read_string(fptr, nxt_string); 
-                    }
-                } else {
-                    printf("no priority\n");
+            not_eol = read_string(fptr, nxt_string, TOKEN_SZ); 
+           /* If string read was a priority: assign to variable */ 
+            if (str_to_priority(nxt_string, &priority)) {
+                /* If string read was not the end of the line */
+                if (not_eol == 1) { 
+                    /* Read next string: timing attribute or process name */ 
+                    not_eol = read_string(fptr, nxt_string, TOKEN_SZ); 
                 }
+            } else {
+                printf("no priority\n");
+            }
+            /* Read the timing attributes, if any */
+            while (strchr(nxt_string, EQUALS) != NULL) {
+                str_to_timing(nxt_string, &period, &deadline, &wcet);
+                if (not_eol != 1) break;
+                not_eol = read_string(fptr, nxt_string, TOKEN_SZ);
             }
+            /* The loader copies the name */
             load_process(process_name, priority);
+            if (period || deadline || wcet) load_timing(process_name, period, deadline, wcet);
             /* Assing process name */ 
-            process_name = nxt_string; 
+            strcpy(process_name, nxt_string); 
         }
         success = TRUE;
     } else {
@@ -202,17 +243,15 @@ bool_t read_processes(FILE *fptr, char *line) {
  * @param line A pointer to a string read from the file.
  */
 bool_t read_resources(FILE *fptr, char *line) {
-    char *resourceName;
+    char resourceName[TOKEN_SZ];
     bool_t success = TRUE;
 
     /* If resource list provided */
     if (strcmp(line, RESOURCES)==0) {
-        resourceName = malloc(NAME_SZ * sizeof(char));
         /* While not the last resource */ 
-        while (read_string(fptr, resourceName) != 0) {
+        while (read_string(fptr, resourceName, TOKEN_SZ) == 1) {
             /* Load resource */ 
             load_resource(resourceName);
-            resourceName = malloc(NAME_SZ * sizeof(char));
         }
         /* Load last resource */ 
         load_resource(resourceName);
@@ -237,16 +276,14 @@ bool_t read_resources(FILE *fptr, char *line) {
  * @param line A pointer to a string read from file.
  */
 bool_t read_mailboxes(FILE *fptr, char *line) {
-    char *mailboxName;
+    char mailboxName[TOKEN_SZ];
     bool_t success = TRUE;
 
     /* If mailbox list provided */
     if (strcmp(line, MAILBOXES)==0) {
-        mailboxName = malloc(strlen(line) * sizeof(char));
         /* While not the last mailbox */ 
-        while (read_string(fptr, mailboxName) != 0) {
+        while (read_string(fptr, mailboxName, TOKEN_SZ) == 1) {
             load_mailbox(mailboxName);
-            mailboxName = malloc(strlen(line) * sizeof(char));
         }
         /* Load last mailbox */ 
         load_mailbox(mailboxName);
@@ -266,35 +303,42 @@ bool_t read_mailboxes(FILE *fptr, char *line) {
  *
  * Reads the list of instructions for each process and loads it in the
  * appropriate datastructure using the functions defined in data_structs.h
+ * A word where a Process is expected is skipped.
  *
  * @param fptr A pointer to the file from which to read.
- * @param line A pointer to a string read from file.
+ * @param line A pointer to a string read from file, of TOKEN_SZ.
  *
  * @return s Indicates the current status of reading the process.
  */
 int read_process(FILE *fptr, char *line) {
-    char *resource_name;
-    char *process_name;
-    char *msg;
+    char resource_name[TOKEN_SZ];
+    char process_name[TOKEN_SZ];
+    char msg[MSG_SZ];
+    bool_t try_only, shared;
     int s;
 
     s = 0; /* Must test this assignment */
 
     if (strcmp(line, PROCESS) == 0) {
         /* reads the process name */
-        process_name = malloc(sizeof(char)*3);
-        read_string(fptr, process_name); 
+        read_string(fptr, process_name, TOKEN_SZ); 
         /* 1. Use the resource_name to find the relevant pcb */
 #ifdef DEBUG_LOADER
         printf("Process %s\n", process_name);
 #endif 
-        resource_name = malloc(sizeof(char) * 64);
-        while ((s = read_string(fptr, resource_name)) != 0 && s != 2) {
-            if (strcmp(resource_name, REQ) == 0) {
-                /* Read the REQ resource */
-                read_req_resource(fptr, resource_name);
+        while ((s = read_string(fptr, resource_name, TOKEN_SZ)) != 0 && s != 2) {
+            if (strcmp(resource_name, REQ) == 0 || strcmp(resource_name, TRYREQ) == 0
+                || strcmp(resource_name, REQS) == 0) {
+                /* Read the REQ resource, a TRYREQ never waits for it and a REQS shares it */
+                try_only = (strcmp(resource_name, TRYREQ) == 0);
+                shared = (strcmp(resource_name, REQS) == 0);
+                s = read_req_resource(fptr, resource_name);
                 load_instruction(process_name, REQ_OP,
                                  resource_name, NULL);
+                if (try_only) load_request_timeout(0);
+                if (shared) load_request_shared();
+                /* Read the rest of the line: more resources of the request */
+                if (s == 1) read_req_arguments(fptr, resource_name, try_only);
                 /* 2. Store instruction using the pcb pointer */
             } else if (strcmp(resource_name, REL) == 0) {
                 /* Read the REL resource */
@@ -303,28 +347,22 @@ int read_process(FILE *fptr, char *line) {
                                  resource_name, NULL);
             } else if (strcmp(resource_name, SEND) == 0) {
                 /* Read the COMMS resource */
-                msg = read_comms_send(fptr, resource_name);
+                read_comms_send(fptr, resource_name, msg);
                 load_instruction(process_name, SEND_OP, 
                                  resource_name, msg);
             } else if (strcmp(resource_name, RECV) == 0) {
                 /* Read the COMMS resource */
-                msg = read_comms_recv(fptr, resource_name);
+                read_comms_recv(fptr, resource_name, msg);
                 load_instruction(process_name, RECV_OP, 
                                  resource_name, msg);
-            } else {
-                /* Execute on white spaces */
-                /* Execute the while loop when encountering new lines and white 
-                 * spaces, exit the loop when encountering the instructions for
-                 * the next Process */
-                if (strcmp(resource_name, "") != 0) {
-                    break;
-                } else {
-                    free(resource_name);
-                }
+            } else if (strcmp(resource_name, "") != 0) {
+                /* Skip new lines and white spaces, exit the loop when
+                 * encountering the instructions for the next Process */
+                break;
             }
-            resource_name = malloc(sizeof(char)*64);
         }
-        free(resource_name);
+    } else {
+        s = read_string(fptr, line, TOKEN_SZ);
     }
     return s;
 }
@@ -337,12 +375,63 @@ int read_process(FILE *fptr, char *line) {
  *
  * @param fptr A pointer to the file from which to read.
  * @param line A pointer to a string read from file.
+ *
+ * @return The status of read_string: 1 if the line goes on
  */
-void read_req_resource(FILE *fptr, char *line) {
-    read_string(fptr, line);
+int read_req_resource(FILE *fptr, char *line) {
+    int status = read_string(fptr, line, TOKEN_SZ);
 #ifdef DEBUG_LOADER
     printf("req %s\n", line);
 #endif
+    return status;
+}
+
+/**
+ * @brief Reads the words after the first resource of a request instruction
+ *        up to the end of the line.
+ *
+ * <code>req R1 R2 R3</code> requests all the resources at once: the last
+ * loaded instruction becomes a request of the set.
+ * <code>req R timeout T</code> gives up after waiting T ticks; a tryreq
+ * never waits, so it takes no timeout.
+ *
+ * @param fptr A pointer to the file from which to read.
+ * @param resource_name The first resource of the request.
+ * @param try_only Whether the request is a tryreq.
+ */
+void read_req_arguments(FILE *fptr, char *resource_name, bool_t try_only) {
+    char **names = malloc(sizeof(char *));
+    char **grown;
+    char word[TOKEN_SZ];
+    int count = 1, status = 1, ch;
+
+    if (names == NULL) return;
+    names[0] = str_at(str_intern(resource_name, strlen(resource_name)));
+    while (status == 1 && names[count - 1] != NULL) {
+        /* Stop at the end of the line, also after trailing spaces */
+        while ((ch = read_char(fptr)) == WHITESPACE);
+        if (ch == '\n' || ch == EOF) break;
+        ungetc(ch, fptr);
+
+        status = read_string(fptr, word, TOKEN_SZ);
+        if (strcmp(word, TIMEOUT) == 0) {
+            if (status == 1) status = read_string(fptr, word, TOKEN_SZ);
+            if (try_only) printf("Timeout of a tryreq rejected %s\n", word);
+            else if (isdigit((unsigned char)word[0])) load_request_timeout(atoi(word));
+            else printf("Timeout without a number of ticks %s\n", word);
+            continue;
+        }
+        grown = realloc(names, (count + 1) * sizeof(char *));
+        if (grown == NULL) break;
+        names = grown;
+        /* The names of the set are in the string table, NULL if out of memory */
+        names[count++] = str_at(str_intern(word, strlen(word)));
+#ifdef DEBUG_LOADER
+        printf("req ... %s\n", word);
+#endif
+    }
+
+    if (count < 2 || names[count - 1] == NULL || !load_resource_set(names, count)) free(names);
 }
 
 /**
@@ -355,7 +444,7 @@ void read_req_resource(FILE *fptr, char *line) {
  * @param line A pointer to a string read from file.
  */
 void read_rel_resource(FILE *fptr, char *line) {
-    read_string(fptr, line);
+    read_string(fptr, line, TOKEN_SZ);
 #ifdef DEBUG_LOADER
     printf("rel %s\n", line);
 #endif
@@ -368,63 +457,48 @@ void read_rel_resource(FILE *fptr, char *line) {
  * well as the message to be loaded.
  *
  * @param fptr A pointer to the file from which to read.
- * @param line A pointer to a string read from file.
- *
- * @return message The message which the instruction will send.
+ * @param line Where the mailbox is stored, of TOKEN_SZ.
+ * @param message Where the message to send is stored, of MSG_SZ.
  */
-char *read_comms_send(FILE *fptr, char *line) {
+void read_comms_send(FILE *fptr, char *line, char *message) {
     int ch;
-    char *message;
     int index;
 
-    message = malloc(sizeof(char) * 128);
-    for (index = 0; index < 128; index++) {
-        message[index] = '\0';
-    }
-
-    while ((ch = fgetc(fptr)) != '\n') {
+    line[0] = '\0';
+    message[0] = '\0';
+    while ((ch = read_char(fptr)) != '\n' && ch != EOF) {
         /* Check to make sure that the character is in the
          * range of all the ascii letters */
         if ((ch >= 65 && ch <= 90) || (ch >= 97 && ch <= 122)) {
-            index = 1;
-            line[0] = ch; 
-            while ((ch = fgetc(fptr)) != COMMA) {
-                if (ch != WHITESPACE) {
-                    line[index] = ch;
-                    index++;
-                }
+            index = 0;
+            for (; ch != COMMA && ch != '\n' && ch != EOF; ch = read_char(fptr)) {
+                if (ch != WHITESPACE && index < TOKEN_SZ - 1) line[index++] = ch;
             }
             /* Adds the termination character at the string end */
             line[index] = '\0'; 
+            if (ch != COMMA) break;
             /* Remove leading whitespace */
-            while (isspace(ch = fgetc(fptr)));
+            while (isspace(ch = read_char(fptr)));
             /* Skip leading quotation mark */
             if (ch == '"') {
-                ch = fgetc(fptr);
+                ch = read_char(fptr);
             }
 
             index = 0;
-             while (ch != RIGHTBRACKET) {
-                message[index] = ch;
-                index++;
-                ch = fgetc(fptr);
+            for (; ch != RIGHTBRACKET && ch != EOF; ch = read_char(fptr)) {
+                if (index < MSG_SZ - 1) message[index++] = ch;
             }
-            index--;
             /* Remove trailing whitespace */
-            while (isspace(message[index])) {
-                message[index] = '\0';
-                index--;
-            }
+            while (index > 0 && isspace((unsigned char)message[index - 1])) index--;
             /* Remove trailing quotation mark */
-            if (message[index] == '"') {
-                message[index] = '\0';
-            }
+            if (index > 0 && message[index - 1] == '"') index--;
+            message[index] = '\0';
+            if (ch == EOF) break;
         }
     }
 #ifdef DEBUG_LOADER
     printf("send (%s, %s)\n", line, message);
 #endif
-    return message;
 }
 
 /**
@@ -437,75 +511,83 @@ char *read_comms_send(FILE *fptr, char *line) {
  * read message.
  *
  * @param fptr A pointer to the file from which to read.
- * @param line A pointer to a string read from file.
- *
- * @return message A placeholder for the variable which receives the message.
+ * @param line Where the mailbox is stored, of TOKEN_SZ.
+ * @param message Where the placeholder for the variable which receives the
+ *        message is stored, of MSG_SZ.
  */
-char *read_comms_recv(FILE *fptr, char *line) {
+void read_comms_recv(FILE *fptr, char *line, char *message) {
     int ch;
-    char *message;
     int index;
 
-    message = malloc(sizeof(char) * 128);
-    for (index = 0; index < 128; index++) {
-        message[index] = '\0';
-    }
-
-    while ((ch = fgetc(fptr)) != '\n') {
+    line[0] = '\0';
+    message[0] = '\0';
+    while ((ch = read_char(fptr)) != '\n' && ch != EOF) {
         /* Check to make sure that the character is in the
         * range of all the ascii letters */
         if ((ch >= 65 && ch <= 90) || (ch >= 97 && ch <= 122)) {
-            index = 1;
-            line[0] = ch; 
-            while ((ch = fgetc(fptr)) != COMMA) {
-                if (ch != WHITESPACE) {
-                    line[index] = ch;
-                    index++;
-                }
+            index = 0;
+            for (; ch != COMMA && ch != '\n' && ch != EOF; ch = read_char(fptr)) {
+                if (ch != WHITESPACE && index < TOKEN_SZ - 1) line[index++] = ch;
             }
             line[index] = '\0';
+            if (ch != COMMA) break;
             index = 0;
-            while ((ch = fgetc(fptr)) != RIGHTBRACKET) {
-                message[index] = ch;
-                index++;
+            while ((ch = read_char(fptr)) != RIGHTBRACKET && ch != EOF) {
+                if (index < MSG_SZ - 1) message[index++] = ch;
             }
+            message[index] = '\0';
+            if (ch == EOF) break;
         }
     }
 #ifdef DEBUG_LOADER
     printf("recv (%s, %s)\n", line, message);
 #endif
-    return message;
 }
 
 /**
  * @brief Reads the next string.
  *
  * Reads the file character for character and constructs a string until a white
- * space or termination character is matched.
+ * space or termination character is matched. A string longer than the space
+ * for it is cut.
  *
  * @param fptr A pointer to the file from which to read.
  * @param line A pointer to space where the string can be stored.
+ * @param size The size of that space.
  *
  * return status The status indicates when the END_OF_FILE or NEW LINE has 
  * been reached.
  */
-int read_string(FILE *fptr, char *line) {
-    int index = 0;
+int read_string(FILE *fptr, char *line, size_t size) {
+    size_t index = 0;
     int ch = 0;
     int status = 1;
+    bool_t cut = FALSE;
 
-    ch = fgetc(fptr);
+    ch = read_char(fptr);
     while (ch != '\n' && ch != ' ') {
         if (ch == EOF) {
             status = END_OF_FILE;
             break;
         }
-        line[index] = ch;
-        index++;
-        ch = fgetc(fptr);
+        if (index + 1 < size) line[index++] = ch;
+        else cut = TRUE;
+        ch = read_char(fptr);
         status = (ch == '\n' ? 0 : 1);
     }
     line[index] = '\0';
+    if (cut) printf("Word too long, cut to %zu characters: %s\n", size - 1, line);
 
     return status;
 }
+
+/**
+ * @brief Reads the next character, skipping the carriage return of a line
+ *        that ends in "\r\n".
+ */
+int read_char(FILE *fptr) {
+    int ch;
+
+    while ((ch = fgetc(fptr)) == '\r');
+    return ch;
+}
@@ -6,15 +6,37 @@
 #ifndef STRUCTS_H
 #define STRUCTS_H
 
+#include <limits.h>
+#include "rbtree.h"
+
+/** Bits in a word of a resource bitmap, the bit of resource id i is i % RESOURCE_BITS of word i / RESOURCE_BITS */
+#define RESOURCE_BITS (sizeof(unsigned long) * CHAR_BIT)
+
 typedef enum {NEW = 0, READY, RUNNING, WAITING, TERMINATED} state_t;
 typedef enum {REQ_OP = 0, REL_OP, SEND_OP, RECV_OP} instr_types_t; 
 typedef enum {NO = 0, YES = 1} available_t; 
 typedef enum {FALSE = 0, TRUE = 1} bool_t;
 
+/** Id of a pcb, its PID: the index of the pcb in the pcb tables */
+typedef unsigned int pcb_id_t;
+
+/** The id of no pcb, ends a list of pcbs */
+#define NO_PCB UINT_MAX
+
+/** Timeout of a request that waits as long as it takes */
+#define NO_TIMEOUT -1
+
 /** Each process has a linked list of instructions to execute.  */
 typedef struct instr_t {
   instr_types_t type;
   char *resource_name; /* any resource, including a mailbox */
+  int resource_id; /* id of the loaded resource, -1 for a mailbox or an undeclared name */
+  int set_size; /* number of resources of a multi-resource request, 0 for one resource */
+  char **set_names; /* the resources of a multi-resource request, the first is resource_name */
+  int *set_ids; /* ids of set_names */
+  unsigned long *set_mask; /* bitmap of set_ids, one bit per resource id */
+  int timeout; /* ticks a request may wait before it gives up, 0 for tryreq, NO_TIMEOUT to wait forever */
+  bool_t shared; /* a reqs: the resources are held in shared mode, with other readers */
   char *msg; /* the message of a send or receive instruction */
   struct instr_t *next;
 } instr_t;
@@ -24,6 +46,9 @@ typedef struct process_in_mem_t {
   int number; 
   char *name;
   instr_t *first_instr; /* All the instructions of a process - should not be changed until the end of the program when the memory is freed */  
+  int period; /* time between two releases of a periodic process, 0 if not periodic */
+  int deadline; /* relative deadline of every job, 0 if none (the period if periodic) */
+  int wcet; /* declared worst case execution time, 0 if not declared */
 } process_in_mem_t;
 
 /** A type that represents a mailbox resource */
@@ -36,7 +61,16 @@ typedef struct mailbox_t {
 /** A type that represents a resource */
 typedef struct resource_t {
   char *name;
+  int id; /* position in the resource table, ids are dense from 0 */
   available_t available; 
+  struct pcb_t *holder; /* process holding the resource exclusively, NULL if available or shared */
+  int readers; /* processes holding the resource in shared mode */
+  int writers_waiting; /* exclusive requests waiting for it, new readers wait behind them */
+  bool_t shared; /* in the list of resources of a process: held in shared mode */
+  struct resource_t *parent; /* the resource it is part of (DB for DB/T1), NULL for a top level resource */
+  int intent_shared; /* holds of descendants in shared mode, each an IS intention lock */
+  int intent_exclusive; /* holds of descendants in exclusive mode, each an IX intention lock */
+  int ceiling; /* highest priority of the processes that request it, -1 if none */
   struct resource_t *next;
 } resource_t;
 
@@ -44,7 +78,7 @@ typedef struct resource_t {
   * required to obtain the the addresses of the pages in memory 
   * (via the page tables) where the process is stored.  
 
-  * In this code the PCB points directly to a data structure,
+  * In this code the PCB leads directly to a data structure,
   * called a process_in_mem, where the process instructions are stored.  
   *
   * Note that next_instruction can point to any of the instructions in the
@@ -52,25 +86,62 @@ typedef struct resource_t {
   * next_instruction will point to the 2nd instruction in the process's linked
   * list of instructions stored in process_in_mem, while process_in_memo will
   * still point to the first_instruction in the linked list. 
+  *
+  * A PCB is split by how often it is used. The pcb_t holds what dispatch
+  * and the queue walks read, in 32 bytes so that two share a cache line,
+  * and links the queues with 32-bit pcb ids. The rest of the PCB is the
+  * pcb_cold_t with the same id and the name and instructions are the
+  * process_in_mem with the same id; pcb_pool.h maps an id to each.
   */
 typedef struct pcb_t {
-  struct process_in_mem_t *process_in_mem; /* process */
   int state; /* see enum state_t */
-  struct instr_t *next_instruction; /* a ptr to an instruction in the linked list of instructions */ 
   int priority; /* used for priority based scheduling */ 
-  resource_t *resources; /* list of resources allocated to process */
-  struct pcb_t *next;
+  pcb_id_t id; /* PID: index of the pcb in the hot, cold and process_in_mem tables */
+  pcb_id_t next; /* next process in its queue or list, NO_PCB if last */
+  pcb_id_t prev; /* previous process on the waitingq, NO_PCB if first */
+  struct instr_t *next_instruction; /* a ptr to an instruction in the linked list of instructions */ 
 } pcb_t;
 
+/** The fields of a PCB that are not read on every dispatch, see pcb_t */
+typedef struct pcb_cold_t {
+  pcb_id_t id; /* the pcb this is the cold part of */
+  int base_priority; /* priority without inheritance */
+  resource_t *resources; /* list of resources allocated to process */
+  resource_t *blocked_on; /* resource the process is waiting for, NULL if none */
+  int remaining; /* instructions left to execute, used for shortest job scheduling */
+  unsigned long ready_seq; /* when the process last became ready, breaks ties */
+  int heap_idx; /* position in a pcb heap, -1 if not in one */
+  int wait_idx; /* position in the heap of waiters of blocked_on, -1 if not in one */
+  int fifo_idx; /* position in the waiters of blocked_on in wait order, -1 if not in one */
+  unsigned long wait_seq; /* when the process last started to wait, orders the waiters of a resource */
+  unsigned long vruntime; /* weighted time on the CPU (fair scheduling vruntime, stride pass) */
+  rb_node_t rb_node; /* node in the fair scheduler's tree */
+  long release; /* release time of the current job */
+  long abs_deadline; /* absolute deadline of the current job, LONG_MAX if none */
+  int jobs; /* jobs completed */
+  int deadline_misses; /* jobs completed after their deadline */
+  long max_lateness; /* largest completion time - deadline over all jobs */
+  long age_key; /* priority * AGING_INTERVAL - time it became ready, for aging */
+  long wait_until; /* time a timed request gives up waiting */
+  bool_t writer_waiting; /* its exclusive request is counted in writers_waiting of its resources */
+} pcb_cold_t;
+
 /** Returns a pointer to the linked list of the loaded process pcbs */
 struct pcb_t* get_init_pcbs();
 
 /** Returns a pointer to the linked list of the loaded process pcbs */
 struct pcb_t* get_new_pcb();
 
+/** Returns a pointer to the linked list of pcbs arriving during scheduling */
+struct pcb_t* get_arrival_pcbs();
+
 /** Returns a pointer to the linked list of the loaded resources */
 struct resource_t* get_available_resources();
 
+/** Returns the loaded resource with id <code>id</code>, NULL if there is none */
+struct resource_t* get_resource(int id);
+/** Returns the number of loaded resources */
+int get_num_resources();
 /** Returns a pointer to the linked list of the loaded mailboxes */
 struct mailbox_t* get_mailboxes();
 
@@ -83,10 +154,13 @@ void dealloc_data_structures();
 /** Deallocates the memory that was allocated for a pcb list */
 void dealloc_pcb_list();
 
+/** Deallocates the instructions and holds of a process and recycles its pcb */
+void dealloc_pcb(struct pcb_t *pcb);
+
 /** Deallocates the memory that was allocated for an instruction */
 void dealloc_instruction(struct instr_t *i);
 
-/** Deallocates the memory that was allocated for a process name */
+/** Forgets the process of the last instruction loaded */
 void dealloc_last_proc_name();
 
 /** Returns a pointer to the pcb linked list of parsed processes */
@@ -101,10 +175,24 @@ void init_loader();
 /** Creates a pcb for process <code>process_name</code> with <code>priority</code> */
 bool_t load_process(char *process_name, int priority);
 
+/** Sets the timing attributes of periodic process <code>process_name</code> */
+bool_t load_timing(char *process_name, int period, int deadline, int wcet);
+
 /** Loads and stores an instruction of process <code>process_name</code> */
 bool_t load_instruction(char *process_name, instr_types_t instruction, 
     char *resource_name, char *msg);
 
+/** Sets the resource id of every request and release instruction */
+void index_resources(struct pcb_t *pcbs);
+/** Sets the ceiling of every resource from the processes that request it */
+void compute_resource_ceilings(struct pcb_t *pcbs);
+
+/** Makes the last loaded instruction a request of all <code>count</code> resources in <code>resource_names</code> */
+bool_t load_resource_set(char **resource_names, int count);
+/** Makes the last loaded instruction a request that gives up after waiting <code>ticks</code> */
+bool_t load_request_timeout(int ticks);
+/** Makes the last loaded instruction a request in shared mode */
+bool_t load_request_shared();
 /** Loads a mailbox */
 bool_t load_mailbox(char *mailboxName);
 
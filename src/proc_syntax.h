@@ -9,15 +9,28 @@
 #define MAILBOXES "Mailboxes"
 #define PROCESS "Process"
 #define REQ "req"
+#define TRYREQ "tryreq"
+#define REQS "reqs"
 #define REL "rel"
 #define SEND "send"
 #define RECV "recv"
 #define SYNC "sync"
 
+/* Timing attributes of a periodic process, written as key=value after its priority */
+#define PERIOD "period"
+#define DEADLINE "deadline"
+#define WCET "wcet"
+
+/* A request that gives up after a number of ticks: req R timeout T */
+#define TIMEOUT "timeout"
+
 #define LEFTBRACKET 40
 #define RIGHTBRACKET 41
 #define COMMA 44
 #define WHITESPACE 32
+#define EQUALS 61
+/* Separates the levels of a hierarchical resource name, e.g. DB/T1/R7 */
+#define SLASH 47
 
 #endif
 
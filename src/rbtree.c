@@ -0,0 +1,271 @@
+/**
+ * @file rbtree.c
+ * @brief An intrusive red-black tree that caches its leftmost node.
+ *
+ * Nodes live inside the structures they order, so inserting and erasing
+ * never allocate. Missing children are NULL and count as black.
+ */
+#include "rbtree.h"
+
+static void rotate_left(rb_tree_t *tree, rb_node_t *x);
+static void rotate_right(rb_tree_t *tree, rb_node_t *x);
+static void replace_child(rb_tree_t *tree, rb_node_t *parent, rb_node_t *old, rb_node_t *new_node);
+static void insert_fixup(rb_tree_t *tree, rb_node_t *z);
+static void erase_fixup(rb_tree_t *tree, rb_node_t *x, rb_node_t *parent);
+
+#define IS_RED(n) ((n) != NULL && (n)->color == RB_RED)
+#define IS_BLACK(n) ((n) == NULL || (n)->color == RB_BLACK)
+
+/**
+ * @brief Initialises an empty tree
+ */
+void rb_init(rb_tree_t *tree, rb_less_t less)
+{
+    tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->count = 0;
+    tree->less = less;
+}
+
+/**
+ * @brief Inserts a node, keeping the tree balanced and the leftmost cached
+ */
+void rb_insert(rb_tree_t *tree, rb_node_t *node)
+{
+    rb_node_t *parent = NULL;
+    rb_node_t **link = &tree->root;
+    int leftmost = 1;
+
+    while (*link != NULL) {
+        parent = *link;
+        if (tree->less(node, parent)) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = 0;
+        }
+    }
+
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+    if (leftmost) tree->leftmost = node;
+    tree->count++;
+
+    insert_fixup(tree, node);
+}
+
+/**
+ * @brief Removes a node, keeping the tree balanced and the leftmost cached
+ */
+void rb_erase(rb_tree_t *tree, rb_node_t *z)
+{
+    rb_node_t *y = z;
+    rb_node_t *x, *x_parent;
+    rb_color_t removed_color = y->color;
+
+    if (tree->leftmost == z) tree->leftmost = rb_next(z);
+
+    if (z->left == NULL) {
+        x = z->right;
+        x_parent = z->parent;
+        replace_child(tree, z->parent, z, x);
+    } else if (z->right == NULL) {
+        x = z->left;
+        x_parent = z->parent;
+        replace_child(tree, z->parent, z, x);
+    } else {
+        /* Replace z by its successor y, the leftmost node of its right subtree */
+        y = z->right;
+        while (y->left != NULL) y = y->left;
+        removed_color = y->color;
+        x = y->right;
+        if (y->parent == z) {
+            x_parent = y;
+        } else {
+            x_parent = y->parent;
+            replace_child(tree, y->parent, y, x);
+            y->right = z->right;
+            y->right->parent = y;
+        }
+        replace_child(tree, z->parent, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->color = z->color;
+    }
+    if (x != NULL) x->parent = x_parent;
+
+    tree->count--;
+    if (removed_color == RB_BLACK) erase_fixup(tree, x, x_parent);
+
+    z->parent = z->left = z->right = NULL;
+}
+
+/**
+ * @brief Returns the cached smallest node
+ */
+rb_node_t *rb_first(const rb_tree_t *tree)
+{
+    return tree->leftmost;
+}
+
+/**
+ * @brief Returns the in-order successor of a node
+ */
+rb_node_t *rb_next(const rb_node_t *node)
+{
+    const rb_node_t *parent;
+
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL) node = node->left;
+        return (rb_node_t *)node;
+    }
+    parent = node->parent;
+    while (parent != NULL && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return (rb_node_t *)parent;
+}
+
+/* Makes new_node take the place of old as a child of parent (or as root) */
+static void replace_child(rb_tree_t *tree, rb_node_t *parent, rb_node_t *old, rb_node_t *new_node)
+{
+    if (parent == NULL) tree->root = new_node;
+    else if (parent->left == old) parent->left = new_node;
+    else parent->right = new_node;
+    if (new_node != NULL) new_node->parent = parent;
+}
+
+static void rotate_left(rb_tree_t *tree, rb_node_t *x)
+{
+    rb_node_t *y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL) y->left->parent = x;
+    replace_child(tree, x->parent, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+static void rotate_right(rb_tree_t *tree, rb_node_t *x)
+{
+    rb_node_t *y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL) y->right->parent = x;
+    replace_child(tree, x->parent, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+/* Restores the red-black properties after inserting the red node z */
+static void insert_fixup(rb_tree_t *tree, rb_node_t *z)
+{
+    rb_node_t *parent, *grandparent, *uncle;
+
+    while (IS_RED(z->parent)) {
+        parent = z->parent;
+        grandparent = parent->parent;
+        if (parent == grandparent->left) {
+            uncle = grandparent->right;
+            if (IS_RED(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                grandparent->color = RB_RED;
+                z = grandparent;
+            } else {
+                if (z == parent->right) {
+                    z = parent;
+                    rotate_left(tree, z);
+                    parent = z->parent;
+                }
+                parent->color = RB_BLACK;
+                grandparent->color = RB_RED;
+                rotate_right(tree, grandparent);
+            }
+        } else {
+            uncle = grandparent->left;
+            if (IS_RED(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                grandparent->color = RB_RED;
+                z = grandparent;
+            } else {
+                if (z == parent->left) {
+                    z = parent;
+                    rotate_right(tree, z);
+                    parent = z->parent;
+                }
+                parent->color = RB_BLACK;
+                grandparent->color = RB_RED;
+                rotate_left(tree, grandparent);
+            }
+        }
+    }
+    tree->root->color = RB_BLACK;
+}
+
+/* Restores the red-black properties after removing a black node above x */
+static void erase_fixup(rb_tree_t *tree, rb_node_t *x, rb_node_t *parent)
+{
+    rb_node_t *sibling;
+
+    while (x != tree->root && IS_BLACK(x)) {
+        if (x == parent->left) {
+            sibling = parent->right;
+            if (IS_RED(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (IS_BLACK(sibling->left) && IS_BLACK(sibling->right)) {
+                sibling->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (IS_BLACK(sibling->right)) {
+                    sibling->left->color = RB_BLACK;
+                    sibling->color = RB_RED;
+                    rotate_right(tree, sibling);
+                    sibling = parent->right;
+                }
+                sibling->color = parent->color;
+                parent->color = RB_BLACK;
+                if (sibling->right != NULL) sibling->right->color = RB_BLACK;
+                rotate_left(tree, parent);
+                x = tree->root;
+            }
+        } else {
+            sibling = parent->left;
+            if (IS_RED(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (IS_BLACK(sibling->left) && IS_BLACK(sibling->right)) {
+                sibling->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (IS_BLACK(sibling->left)) {
+                    sibling->right->color = RB_BLACK;
+                    sibling->color = RB_RED;
+                    rotate_left(tree, sibling);
+                    sibling = parent->left;
+                }
+                sibling->color = parent->color;
+                parent->color = RB_BLACK;
+                if (sibling->left != NULL) sibling->left->color = RB_BLACK;
+                rotate_right(tree, parent);
+                x = tree->root;
+            }
+        }
+    }
+    if (x != NULL) x->color = RB_BLACK;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file rbtree.h
+ * @description An intrusive red-black tree that caches its leftmost node.
+ */
+#ifndef _RBTREE_H
+#define _RBTREE_H
+
+#include <stddef.h>
+
+typedef enum {RB_RED = 0, RB_BLACK} rb_color_t;
+
+/** A node embedded in the structure that is stored in the tree */
+typedef struct rb_node_t {
+    struct rb_node_t *parent;
+    struct rb_node_t *left;
+    struct rb_node_t *right;
+    rb_color_t color;
+} rb_node_t;
+
+/** Returns non-zero if <code>a</code> sorts before <code>b</code> */
+typedef int (*rb_less_t)(const rb_node_t *a, const rb_node_t *b);
+
+typedef struct rb_tree_t {
+    rb_node_t *root;
+    rb_node_t *leftmost; /* the smallest node, so finding it is O(1) */
+    int count;
+    rb_less_t less;
+} rb_tree_t;
+
+/** Returns the structure of type <code>type</code> that embeds <code>node</code> as <code>member</code> */
+#define rb_entry(node, type, member) ((type *)((char *)(node) - offsetof(type, member)))
+
+/** Initialises an empty tree ordered by <code>less</code> */
+void rb_init(rb_tree_t *tree, rb_less_t less);
+
+/** Inserts <code>node</code> in O(log n); equal keys go after existing ones */
+void rb_insert(rb_tree_t *tree, rb_node_t *node);
+
+/** Removes <code>node</code> in O(log n) */
+void rb_erase(rb_tree_t *tree, rb_node_t *node);
+
+/** Returns the smallest node in O(1), NULL if the tree is empty */
+rb_node_t *rb_first(const rb_tree_t *tree);
+
+/** Returns the node after <code>node</code> in order, NULL if it is the last */
+rb_node_t *rb_next(const rb_node_t *node);
+
+#endif
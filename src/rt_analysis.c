@@ -0,0 +1,336 @@
+/**
+ * @file rt_analysis.c
+ * @brief Schedulability tests for the periodic processes of a workload.
+ *
+ * Every instruction takes one tick, so the execution time C of a job is its
+ * declared wcet or else its number of instructions. A critical section runs
+ * from a req to the matching rel. With the priority ceiling protocol (fixed
+ * priorities) or the stack resource policy (EDF) a job is blocked by at most
+ * one critical section of a job with a lower priority, which gives the
+ * blocking terms B. Deadlines are assumed not to exceed periods.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "proc_structs.h"
+#include "pcb_pool.h"
+#include "partition.h"
+#include "rt_analysis.h"
+
+/* The demand test checks intervals of at most this many ticks */
+#define ANALYSIS_MAX_L 10000000L
+
+/** A periodic process as seen by the analysis */
+typedef struct rt_task_t {
+    pcb_t *pcb;
+    long C;   /* execution time */
+    long T;   /* period */
+    long D;   /* relative deadline */
+    long B;   /* blocking under fixed priorities */
+    long R;   /* worst case response time under fixed priorities */
+} rt_task_t;
+
+static int by_deadline(const void *a, const void *b);
+static long *critical_sections(rt_task_t *tasks, int n, int *num_resources);
+static bool_t fp_response_times(rt_task_t *tasks, int n, long *cs, int m);
+static bool_t edf_demand_test(rt_task_t *tasks, int n, long *cs, int m, double utilization);
+static long hyperperiod(rt_task_t *tasks, int n);
+
+/**
+ * @brief Analyses the periodic processes of a workload
+ *
+ * Prints the utilization against the Liu-Layland and hyperbolic bounds, the
+ * response times under deadline monotonic priorities and the result of the
+ * EDF processor demand test.
+ *
+ * @param procs_loaded The processes that are ready at the start
+ * @param procs_arriving The processes that arrive later
+ *
+ * @return TRUE if the task set is schedulable under fixed priorities or EDF
+ */
+bool_t analyze_task_set(pcb_t *procs_loaded, pcb_t *procs_arriving)
+{
+    pcb_t *lists[] = {procs_loaded, procs_arriving};
+    rt_task_t *tasks;
+    instr_t *instr;
+    pcb_t *pcb;
+    long *cs;
+    double utilization = 0, bound, hyperbolic = 1;
+    int n = 0, others = 0, m, i, l;
+    bool_t fp_ok, edf_ok;
+
+    for (l = 0; l < 2; l++) {
+        for (pcb = lists[l]; pcb != NULL; pcb = pcb_next(pcb)) {
+            if (pcb_mem(pcb)->period > 0) n++;
+            else others++;
+        }
+    }
+    printf("Schedulability analysis of %d periodic process(es)", n);
+    if (others > 0) printf(", %d process(es) without a period not analysed", others);
+    printf("\n");
+    if (n == 0) return TRUE;
+
+    tasks = malloc(n * sizeof(rt_task_t));
+    n = 0;
+    for (l = 0; l < 2; l++) {
+        for (pcb = lists[l]; pcb != NULL; pcb = pcb_next(pcb)) {
+            if (pcb_mem(pcb)->period <= 0) continue;
+            tasks[n].pcb = pcb;
+            tasks[n].C = pcb_mem(pcb)->wcet;
+            if (tasks[n].C == 0) {
+                for (instr = pcb_mem(pcb)->first_instr; instr != NULL; instr = instr->next) tasks[n].C++;
+            }
+            tasks[n].T = pcb_mem(pcb)->period;
+            tasks[n].D = pcb_mem(pcb)->deadline;
+            n++;
+        }
+    }
+    /* Deadline monotonic order: index 0 has the highest priority */
+    qsort(tasks, n, sizeof(rt_task_t), by_deadline);
+
+    for (i = 0; i < n; i++) {
+        utilization += (double)tasks[i].C / tasks[i].T;
+        hyperbolic *= (double)tasks[i].C / tasks[i].T + 1;
+    }
+    bound = n * (pow(2.0, 1.0 / n) - 1);
+
+    cs = critical_sections(tasks, n, &m);
+    fp_ok = fp_response_times(tasks, n, cs, m);
+
+    printf("%-8s %8s %8s %8s %8s %8s\n", "Process", "C", "T", "D", "B", "R");
+    for (i = 0; i < n; i++) {
+        printf("%-8s %8ld %8ld %8ld %8ld %8ld%s\n", pcb_mem(tasks[i].pcb)->name,
+               tasks[i].C, tasks[i].T, tasks[i].D, tasks[i].B, tasks[i].R,
+               tasks[i].R > tasks[i].D ? " missed" : "");
+    }
+    printf("Utilization %.3f: Liu-Layland bound %.3f %s, hyperbolic bound %s\n", utilization, bound,
+           utilization <= bound ? "met" : "not met", hyperbolic <= 2.0 ? "met" : "not met");
+    printf("Fixed priority (deadline monotonic, priority ceiling): %s\n",
+           fp_ok ? "schedulable" : "not schedulable");
+
+    edf_ok = edf_demand_test(tasks, n, cs, m, utilization);
+
+    free(cs);
+    free(tasks);
+    return (fp_ok || edf_ok) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Orders tasks by deadline, then by period
+ */
+static int by_deadline(const void *a, const void *b)
+{
+    const rt_task_t *ta = a, *tb = b;
+
+    if (ta->D != tb->D) return ta->D < tb->D ? -1 : 1;
+    if (ta->T != tb->T) return ta->T < tb->T ? -1 : 1;
+    return pcb_mem(ta->pcb)->number - pcb_mem(tb->pcb)->number;
+}
+
+/**
+ * @brief Measures the longest critical section of every task on every resource
+ *
+ * A section that is never released lasts until the end of the job.
+ *
+ * @param num_resources Receives the number of resources m
+ *
+ * @return An n x m table, 0 where a task does not use a resource
+ */
+static long *critical_sections(rt_task_t *tasks, int n, int *num_resources)
+{
+    name_table_t names;
+    instr_t *instr;
+    long *cs, *start;
+    long len, k;
+    int i, j, r, m;
+
+    init_name_table(&names);
+    for (i = 0; i < n; i++) {
+        for (instr = pcb_mem(tasks[i].pcb)->first_instr; instr != NULL; instr = instr->next) {
+            if (instr->type == REQ_OP || instr->type == REL_OP) name_to_id(&names, instr->resource_name);
+            for (j = 0; j < instr->set_size; j++) name_to_id(&names, instr->set_names[j]);
+        }
+    }
+    m = names.count;
+
+    cs = calloc((size_t)n * m + 1, sizeof(long));
+    start = malloc((m + 1) * sizeof(long));
+    for (i = 0; i < n; i++) {
+        for (r = 0; r < m; r++) start[r] = -1;
+        k = 0;
+        for (instr = pcb_mem(tasks[i].pcb)->first_instr; instr != NULL; instr = instr->next, k++) {
+            if (instr->type == REQ_OP) {
+                /* A request of several resources opens a section on each */
+                r = name_to_id(&names, instr->resource_name);
+                if (r >= 0 && start[r] < 0) start[r] = k;
+                for (j = 0; j < instr->set_size; j++) {
+                    r = name_to_id(&names, instr->set_names[j]);
+                    if (r >= 0 && start[r] < 0) start[r] = k;
+                }
+            } else if (instr->type == REL_OP) {
+                r = name_to_id(&names, instr->resource_name);
+                if (r >= 0 && start[r] >= 0) {
+                    len = k - start[r] + 1;
+                    if (len > cs[i * m + r]) cs[i * m + r] = len;
+                    start[r] = -1;
+                }
+            }
+        }
+        for (r = 0; r < m; r++) {
+            if (start[r] >= 0 && k - start[r] > cs[i * m + r]) cs[i * m + r] = k - start[r];
+        }
+    }
+
+    free(start);
+    free_name_table(&names);
+    *num_resources = m;
+    return cs;
+}
+
+/**
+ * @brief Response time analysis under deadline monotonic priorities
+ *
+ * The ceiling of a resource is the highest priority of its users. Task i is
+ * blocked by the longest section of a lower priority task on a resource
+ * whose ceiling is at least its priority. Its response time R is the fixed
+ * point of R = C + B + sum over higher priorities j of ceil(R / T_j) C_j.
+ *
+ * @return TRUE if every response time is within its deadline
+ */
+static bool_t fp_response_times(rt_task_t *tasks, int n, long *cs, int m)
+{
+    int *ceiling = malloc((m + 1) * sizeof(int));
+    long response, next;
+    bool_t schedulable = TRUE;
+    int i, j, r;
+
+    for (r = 0; r < m; r++) {
+        ceiling[r] = n;
+        for (i = 0; i < n && ceiling[r] == n; i++) {
+            if (cs[i * m + r] > 0) ceiling[r] = i;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        tasks[i].B = 0;
+        for (j = i + 1; j < n; j++) {
+            for (r = 0; r < m; r++) {
+                if (ceiling[r] <= i && cs[j * m + r] > tasks[i].B) tasks[i].B = cs[j * m + r];
+            }
+        }
+
+        response = tasks[i].C + tasks[i].B;
+        for (;;) {
+            next = tasks[i].C + tasks[i].B;
+            for (j = 0; j < i; j++) next += (response + tasks[j].T - 1) / tasks[j].T * tasks[j].C;
+            if (next == response || next > tasks[i].D) break;
+            response = next;
+        }
+        tasks[i].R = next;
+        if (next > tasks[i].D) schedulable = FALSE;
+    }
+
+    free(ceiling);
+    return schedulable;
+}
+
+/**
+ * @brief EDF processor demand test with stack resource policy blocking
+ *
+ * The demand h(L) of the jobs with both release and deadline in [0, L],
+ * plus the longest section B(L) of a task with a deadline after L on a
+ * resource used by a task with a deadline within L, must not exceed L for
+ * any absolute deadline L up to the end of the busy period bound.
+ *
+ * @return TRUE if the test passes
+ */
+static bool_t edf_demand_test(rt_task_t *tasks, int n, long *cs, int m, double utilization)
+{
+    long *next_deadline = malloc(n * sizeof(long));
+    long *blocking = calloc(n + 1, sizeof(long));
+    bool_t *used = calloc(m + 1, sizeof(bool_t));
+    long limit, la, demand = 0, L;
+    double slack = 0;
+    bool_t schedulable = TRUE;
+    int i, j, k, r;
+
+    /* blocking[k]: B(L) while exactly the first k tasks have D <= L */
+    for (k = 0; k <= n; k++) {
+        if (k > 0) {
+            for (r = 0; r < m; r++) if (cs[(k - 1) * m + r] > 0) used[r] = TRUE;
+        }
+        for (j = k; j < n; j++) {
+            for (r = 0; r < m; r++) {
+                if (used[r] && cs[j * m + r] > blocking[k]) blocking[k] = cs[j * m + r];
+            }
+        }
+    }
+
+    if (utilization > 1.0 + 1e-9) {
+        printf("EDF (processor demand, stack resource policy): not schedulable, utilization above 1\n");
+        schedulable = FALSE;
+    } else {
+        limit = hyperperiod(tasks, n) + tasks[n - 1].D;
+        if (utilization < 1.0 - 1e-9) {
+            for (i = 0; i < n; i++) slack += (double)(tasks[i].T - tasks[i].D) * tasks[i].C / tasks[i].T;
+            la = (long)ceil(slack / (1.0 - utilization));
+            if (la < tasks[n - 1].D) la = tasks[n - 1].D;
+            if (la < limit) limit = la;
+        }
+        if (limit > ANALYSIS_MAX_L) limit = ANALYSIS_MAX_L;
+
+        for (i = 0; i < n; i++) next_deadline[i] = tasks[i].D;
+        k = 0;
+        for (;;) {
+            L = next_deadline[0];
+            for (i = 1; i < n; i++) if (next_deadline[i] < L) L = next_deadline[i];
+            if (L > limit) break;
+
+            for (i = 0; i < n; i++) {
+                if (next_deadline[i] == L) {
+                    demand += tasks[i].C;
+                    next_deadline[i] += tasks[i].T;
+                }
+            }
+            while (k < n && tasks[k].D <= L) k++;
+
+            if (demand + blocking[k] > L) {
+                printf("EDF (processor demand, stack resource policy): not schedulable, "
+                       "demand %ld + blocking %ld > %ld\n", demand, blocking[k], L);
+                schedulable = FALSE;
+                break;
+            }
+        }
+        if (schedulable) {
+            printf("EDF (processor demand, stack resource policy): schedulable (checked up to %ld)\n", limit);
+        }
+    }
+
+    free(used);
+    free(blocking);
+    free(next_deadline);
+    return schedulable;
+}
+
+/**
+ * @brief Returns the least common multiple of the periods, at most ANALYSIS_MAX_L
+ */
+static long hyperperiod(rt_task_t *tasks, int n)
+{
+    long lcm = 1, a, b, t;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        a = lcm;
+        b = tasks[i].T;
+        while (b != 0) {
+            t = a % b;
+            a = b;
+            b = t;
+        }
+        lcm = lcm / a * tasks[i].T;
+        if (lcm >= ANALYSIS_MAX_L) return ANALYSIS_MAX_L;
+    }
+    return lcm;
+}
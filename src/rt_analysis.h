@@ -0,0 +1,19 @@
+/**
+ * @file rt_analysis.h
+ * @description Offline schedulability analysis of the periodic processes
+ *              of a workload, without simulating it.
+ */
+#ifndef _RT_ANALYSIS_H
+#define _RT_ANALYSIS_H
+
+#include "proc_structs.h"
+
+/**
+ * Prints the utilization bounds, the fixed priority response times and the
+ * EDF processor demand test of the periodic processes in both lists.
+ *
+ * @return TRUE if the task set is schedulable under fixed priorities or EDF
+ */
+bool_t analyze_task_set(pcb_t *procs_loaded, pcb_t *procs_arriving);
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file str_table.c
+ * @brief The string table of the loader.
+ *
+ * The strings are copied into chunks of STR_CHUNK_SZ, one after the other,
+ * so that a workload costs a handful of allocations instead of one per
+ * name, and a string never moves once stored. An open addressing hash
+ * table of ids, at most half full, finds a string in expected O(length).
+ * The table is filled while loading, before any simulation thread runs.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "str_table.h"
+
+#define NO_STR -1
+
+typedef struct str_chunk_t {
+    struct str_chunk_t *next;
+    size_t used;
+    size_t size;
+    char text[];
+} str_chunk_t;
+
+typedef struct str_entry_t {
+    char *text;
+    size_t len;
+    uint32_t hash;
+} str_entry_t;
+
+static str_chunk_t *chunks = NULL; /* the newest first */
+static str_entry_t *entries = NULL; /* by id */
+static int num_entries = 0;
+static int entry_capacity = 0;
+static int *slots = NULL; /* ids by hash, NO_STR if empty */
+static size_t num_slots = 0;
+
+static uint32_t hash_of(const char *s, size_t len);
+static int lookup(const char *s, size_t len, uint32_t hash, size_t *slot);
+static char *store(const char *s, size_t len);
+static int grow_slots(void);
+
+/**
+ * @brief Returns the id of a string, adding it if it is new
+ *
+ * @param s The characters, not necessarily terminated
+ * @param len The number of characters
+ *
+ * @return The id, -1 if out of memory
+ */
+int str_intern(const char *s, size_t len)
+{
+    str_entry_t *grown;
+    uint32_t hash = hash_of(s, len);
+    size_t slot;
+    int id;
+
+    if ((id = lookup(s, len, hash, &slot)) != NO_STR) return id;
+
+    if (2 * (size_t)(num_entries + 1) > num_slots) {
+        if (!grow_slots()) return NO_STR;
+        lookup(s, len, hash, &slot);
+    }
+    if (num_entries == entry_capacity) {
+        grown = realloc(entries, (entry_capacity ? 2 * entry_capacity : 64) * sizeof(str_entry_t));
+        if (grown == NULL) return NO_STR;
+        entries = grown;
+        entry_capacity = entry_capacity ? 2 * entry_capacity : 64;
+    }
+    entries[num_entries].text = store(s, len);
+    if (entries[num_entries].text == NULL) return NO_STR;
+    entries[num_entries].len = len;
+    entries[num_entries].hash = hash;
+    slots[slot] = num_entries;
+    return num_entries++;
+}
+
+/**
+ * @brief Returns the id of a terminated string, -1 if it is not in the table
+ */
+int str_find(const char *s)
+{
+    size_t slot, len = strlen(s);
+
+    if (num_slots == 0) return NO_STR;
+    return lookup(s, len, hash_of(s, len), &slot);
+}
+
+/**
+ * @brief Returns the string with id <code>id</code>, NULL for an unknown id
+ */
+char *str_at(int id)
+{
+    return (id >= 0 && id < num_entries) ? entries[id].text : NULL;
+}
+
+/**
+ * @brief Returns the number of strings in the table
+ */
+int str_count(void)
+{
+    return num_entries;
+}
+
+/**
+ * @brief Frees the chunks, the ids and the hash table
+ */
+void free_str_table(void)
+{
+    str_chunk_t *next;
+
+    while (chunks != NULL) {
+        next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+    free(entries);
+    free(slots);
+    entries = NULL;
+    slots = NULL;
+    num_entries = entry_capacity = 0;
+    num_slots = 0;
+}
+
+/* FNV-1a */
+static uint32_t hash_of(const char *s, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) hash = (hash ^ (unsigned char)s[i]) * 16777619u;
+    return hash;
+}
+
+/**
+ * @brief Looks a string up, leaving in <code>slot</code> the slot where it
+ *        is or would be added
+ *
+ * @return Its id, -1 if it is not in the table
+ */
+static int lookup(const char *s, size_t len, uint32_t hash, size_t *slot)
+{
+    size_t i;
+    str_entry_t *entry;
+
+    if (num_slots == 0) return NO_STR;
+    for (i = hash & (num_slots - 1); slots[i] != NO_STR; i = (i + 1) & (num_slots - 1)) {
+        entry = &entries[slots[i]];
+        if (entry->hash == hash && entry->len == len && memcmp(entry->text, s, len) == 0) {
+            *slot = i;
+            return slots[i];
+        }
+    }
+    *slot = i;
+    return NO_STR;
+}
+
+/**
+ * @brief Copies a string, terminated, to the newest chunk, starting a chunk
+ *        when it does not fit
+ */
+static char *store(const char *s, size_t len)
+{
+    str_chunk_t *chunk = chunks;
+    size_t size;
+    char *text;
+
+    if (chunk == NULL || chunk->size - chunk->used < len + 1) {
+        size = (len + 1 > STR_CHUNK_SZ) ? len + 1 : STR_CHUNK_SZ;
+        chunk = malloc(sizeof(str_chunk_t) + size);
+        if (chunk == NULL) return NULL;
+        chunk->used = 0;
+        chunk->size = size;
+        /* A string of its own size goes behind the current chunk, which may still have room */
+        if (chunks != NULL && size > STR_CHUNK_SZ) {
+            chunk->next = chunks->next;
+            chunks->next = chunk;
+        } else {
+            chunk->next = chunks;
+            chunks = chunk;
+        }
+    }
+    text = chunk->text + chunk->used;
+    memcpy(text, s, len);
+    text[len] = '\0';
+    chunk->used += len + 1;
+    return text;
+}
+
+/**
+ * @brief Doubles the hash table and puts every id back
+ *
+ * @return 0 if out of memory
+ */
+static int grow_slots(void)
+{
+    size_t size = num_slots ? 2 * num_slots : 128;
+    int *grown = malloc(size * sizeof(int));
+    size_t i;
+    int id;
+
+    if (grown == NULL) return 0;
+    for (i = 0; i < size; i++) grown[i] = NO_STR;
+    for (id = 0; id < num_entries; id++) {
+        for (i = entries[id].hash & (size - 1); grown[i] != NO_STR; i = (i + 1) & (size - 1));
+        grown[i] = id;
+    }
+    free(slots);
+    slots = grown;
+    num_slots = size;
+    return 1;
+}
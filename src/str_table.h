@@ -0,0 +1,41 @@
+/**
+ * @file str_table.h
+ * @description The string table of the loader: every name and message of a
+ *              workload is stored once, packed in large chunks, and known by
+ *              a dense id from 0, so that the loader can index by name.
+ *
+ *              Records refer to their names by a pointer into the table
+ *              rather than keeping short names inline: a pointer is 8 bytes,
+ *              which is as small as an inline name would be, the string is
+ *              written once and never moves, and the logger and the
+ *              analyses take the name as a char * without copying.
+ */
+#ifndef _STR_TABLE_H
+#define _STR_TABLE_H
+
+#include <stddef.h>
+
+/** Bytes of a chunk of string storage; longer strings get a chunk of their own */
+#ifndef STR_CHUNK_SZ
+#define STR_CHUNK_SZ 4096
+#endif
+
+/**
+ * Returns the id of the <code>len</code> characters at <code>s</code>,
+ * adding them to the table if they are new; -1 if out of memory.
+ */
+int str_intern(const char *s, size_t len);
+
+/** Returns the id of <code>s</code>, -1 if it is not in the table */
+int str_find(const char *s);
+
+/** Returns the string with id <code>id</code>; it is never to be freed or changed */
+char *str_at(int id);
+
+/** Returns the number of strings in the table, one more than the largest id */
+int str_count(void);
+
+/** Frees the table: every string of it becomes invalid */
+void free_str_table(void);
+
+#endif
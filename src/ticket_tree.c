@@ -0,0 +1,140 @@
+/**
+ * @file ticket_tree.c
+ * @brief A Fenwick (binary indexed) tree of lottery tickets.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "pcb_pool.h"
+#include "ticket_tree.h"
+
+static void grow(ticket_tree_t *tree, int min_size);
+static void add_to_sums(ticket_tree_t *tree, int slot, long delta);
+
+/**
+ * @brief Initialises an empty tree
+ */
+void init_ticket_tree(ticket_tree_t *tree)
+{
+    tree->sums = NULL;
+    tree->slots = NULL;
+    tree->tickets = NULL;
+    tree->size = 0;
+    tree->count = 0;
+    tree->total = 0;
+}
+
+/**
+ * @brief Adds a pcb to the slot of its process number in O(log n)
+ *
+ * The tree grows to the next power of two when a process number does not
+ * fit, which rebuilds the sums in O(n).
+ */
+void ticket_tree_add(ticket_tree_t *tree, pcb_t *pcb, long tickets)
+{
+    int slot;
+
+    if (pcb == NULL) return;
+    slot = pcb_mem(pcb)->number;
+    if (slot >= tree->size) grow(tree, slot + 1);
+    if (tree->slots[slot] != NULL) return;
+    if (tickets < 1) tickets = 1;
+
+    tree->slots[slot] = pcb;
+    tree->tickets[slot] = tickets;
+    tree->count++;
+    tree->total += tickets;
+    add_to_sums(tree, slot, tickets);
+}
+
+/**
+ * @brief Removes a pcb from the tree in O(log n)
+ */
+void ticket_tree_remove(ticket_tree_t *tree, pcb_t *pcb)
+{
+    int slot;
+
+    if (pcb == NULL) return;
+    slot = pcb_mem(pcb)->number;
+    if (slot >= tree->size || tree->slots[slot] != pcb) return;
+
+    add_to_sums(tree, slot, -tree->tickets[slot]);
+    tree->total -= tree->tickets[slot];
+    tree->count--;
+    tree->slots[slot] = NULL;
+    tree->tickets[slot] = 0;
+}
+
+/**
+ * @brief Finds the holder of a ticket by walking down the implicit tree
+ *
+ * Starting from the largest power of two, every step either skips a whole
+ * subtree of tickets or descends into it, so the search is O(log n).
+ */
+pcb_t *ticket_tree_find(ticket_tree_t *tree, long ticket)
+{
+    int pos = 0, step;
+
+    if (tree->count == 0 || ticket < 0 || ticket >= tree->total) return NULL;
+
+    for (step = tree->size; step > 0; step >>= 1) {
+        if (pos + step <= tree->size && tree->sums[pos + step] <= ticket) {
+            pos += step;
+            ticket -= tree->sums[pos];
+        }
+    }
+    /* pos is the number of slots before the winner, slots are 0-based */
+    return tree->slots[pos];
+}
+
+/**
+ * @brief Frees the memory of the tree
+ */
+void free_ticket_tree(ticket_tree_t *tree)
+{
+    free(tree->sums);
+    free(tree->slots);
+    free(tree->tickets);
+    init_ticket_tree(tree);
+}
+
+/**
+ * @brief Resizes the tree to hold at least min_size slots and rebuilds the sums
+ */
+static void grow(ticket_tree_t *tree, int min_size)
+{
+    int size = tree->size ? tree->size : 16;
+    int i, parent;
+
+    while (size < min_size) size <<= 1;
+
+    tree->slots = realloc(tree->slots, size * sizeof(pcb_t *));
+    tree->tickets = realloc(tree->tickets, size * sizeof(long));
+    tree->sums = realloc(tree->sums, (size + 1) * sizeof(long));
+    if (tree->slots == NULL || tree->tickets == NULL || tree->sums == NULL) {
+        fprintf(stderr, "Memory allocation failed for ticket tree\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = tree->size; i < size; i++) {
+        tree->slots[i] = NULL;
+        tree->tickets[i] = 0;
+    }
+    tree->size = size;
+
+    /* Rebuild the sums in O(n): every node pushes its sum to its parent */
+    for (i = 1; i <= size; i++) tree->sums[i] = tree->tickets[i - 1];
+    for (i = 1; i <= size; i++) {
+        parent = i + (i & -i);
+        if (parent <= size) tree->sums[parent] += tree->sums[i];
+    }
+}
+
+/**
+ * @brief Adds delta to the tickets of slot and all sums covering it
+ */
+static void add_to_sums(ticket_tree_t *tree, int slot, long delta)
+{
+    int i;
+
+    for (i = slot + 1; i <= tree->size; i += i & -i) tree->sums[i] += delta;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file ticket_tree.h
+ * @description A Fenwick tree of lottery tickets, used as a ready queue by
+ *              the lottery scheduler.
+ */
+#ifndef _TICKET_TREE_H
+#define _TICKET_TREE_H
+
+#include "proc_structs.h"
+
+/**
+ * Every process owns the slot of its process number. The tree keeps prefix
+ * sums of the tickets in the slots, so adding, removing and drawing the
+ * winner of a lottery are all O(log n).
+ */
+typedef struct ticket_tree_t {
+    long *sums;    /* Fenwick prefix sums, 1-based */
+    pcb_t **slots; /* the pcb in every slot, NULL if the slot is empty */
+    long *tickets; /* the tickets held in every slot */
+    int size;      /* number of slots, a power of two */
+    int count;     /* number of pcbs in the tree */
+    long total;    /* sum of all tickets in the tree */
+} ticket_tree_t;
+
+/** Initialises an empty tree */
+void init_ticket_tree(ticket_tree_t *tree);
+
+/** Adds <code>pcb</code> holding <code>tickets</code> tickets (at least 1) */
+void ticket_tree_add(ticket_tree_t *tree, pcb_t *pcb, long tickets);
+
+/** Removes <code>pcb</code> from the tree */
+void ticket_tree_remove(ticket_tree_t *tree, pcb_t *pcb);
+
+/**
+ * Returns the holder of ticket <code>ticket</code> (0 <= ticket < total),
+ * counting tickets in slot order. NULL if the tree is empty.
+ */
+pcb_t *ticket_tree_find(ticket_tree_t *tree, long ticket);
+
+/** Frees the memory of the tree (not the pcbs) */
+void free_ticket_tree(ticket_tree_t *tree);
+
+#endif
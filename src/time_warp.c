@@ -0,0 +1,880 @@
+/**
+ * @file time_warp.c
+ * @brief Optimistic (Time Warp) parallel simulation of interacting processes.
+ *
+ * The processes are split over partitions (logical processes) that each own
+ * a CPU and run on their own thread. All partitions advance in lock step on
+ * a common clock of one instruction per tick. A resource named by a single
+ * partition is private to it. A resource named by several partitions is
+ * shared: whether it is free at tick t depends on what the other partitions
+ * did before t.
+ *
+ * Every partition executes a window of ticks speculatively. It records the
+ * shared resources it acquired and released (its events) and every answer it
+ * assumed about the other partitions (its queries). Events are totally
+ * ordered by the key t * partitions + partition, so partitions acting in the
+ * same tick are ordered by their number. At the end of the window the events
+ * of all partitions are combined and every query is checked against them.
+ * Partitions that assumed something that turned out to be false roll back to
+ * the state saved at the start of the window and run it again, now seeing
+ * the events of the others. The earliest wrong assumption in the window is
+ * always corrected by such a rerun, so the window converges. Once all
+ * queries agree, the global virtual time (GVT) moves to the end of the
+ * window: the window is committed, its log is written in key order and the
+ * saved states and events of the window are reclaimed.
+ */
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "proc_structs.h"
+#include "pcb_pool.h"
+#include "logger.h"
+#include "partition.h"
+#include "time_warp.h"
+
+#define TW_NONE -1
+#define TW_NEVER LONG_MAX
+
+typedef enum {EV_ARRIVED = 0, EV_READY, EV_ACQUIRED, EV_WAITING,
+              EV_RELEASED, EV_REL_ERROR, EV_TERMINATED} tw_event_kind_t;
+
+/** An instruction with its resource replaced by a dense id */
+typedef struct tw_instr_t {
+    instr_types_t type;
+    int res;
+} tw_instr_t;
+
+/** The part of a process that changes while simulating */
+typedef struct tw_proc_state_t {
+    int pc;    /* index of the next instruction */
+    int state; /* see enum state_t */
+    int seq;   /* order in which the process became ready */
+} tw_proc_state_t;
+
+/** A process of the compact model */
+typedef struct tw_proc_t {
+    pcb_t *pcb;
+    tw_instr_t *instrs;
+    int num_instrs;
+    int lp;
+} tw_proc_t;
+
+/** Something that happened in a partition, logged when the window commits */
+typedef struct tw_event_t {
+    long key;
+    tw_event_kind_t kind;
+    int proc;
+    int res;
+    int order; /* position in the partition's history, keeps the sort stable */
+} tw_event_t;
+
+/** An assumption about other partitions: was res busy at key? */
+typedef struct tw_query_t {
+    long key;
+    int res;
+    bool_t busy;
+} tw_query_t;
+
+/** A hold of a shared resource by a partition: (start, end) in keys */
+typedef struct tw_interval_t {
+    long start;
+    long end;
+    int lp;
+} tw_interval_t;
+
+/** The holds of every shared resource */
+typedef struct tw_table_t {
+    tw_interval_t **intervals;
+    int *count;
+    int *cap;
+} tw_table_t;
+
+/** A partition (logical process) */
+typedef struct tw_lp_t {
+    int id;
+    int *procs;          /* processes in load order */
+    int num_procs;
+    int *arrivals;       /* processes that arrive while simulating */
+    int num_arrivals;
+
+    /* state while simulating */
+    long now;
+    int running;
+    int next_arrival;
+    int next_seq;
+    int executed;        /* instructions and arrivals in this window */
+    int *holder;         /* own process holding each resource, TW_NONE if none */
+
+    /* state at the GVT, restored on rollback */
+    long saved_now;
+    int saved_running;
+    int saved_next_arrival;
+    int saved_next_seq;
+    int *saved_holder;
+    tw_proc_state_t *saved_procs;
+
+    /* optimistic history since the GVT */
+    tw_event_t *events;
+    int num_events, cap_events;
+    tw_query_t *queries;
+    int num_queries, cap_queries;
+} tw_lp_t;
+
+/** The whole optimistic simulation */
+typedef struct tw_run_t {
+    tw_proc_t *procs;
+    tw_proc_state_t *state;
+    int num_procs;
+    char **res_names;
+    bool_t *shared;
+    int num_res;
+    tw_lp_t *lps;
+    int num_lps;
+    bool_t priority_sched;
+    const tw_table_t *view; /* what the partitions assume the others did */
+
+    /* partitions to (re)run in the current pass, shared with the workers */
+    int *todo;
+    int num_todo;
+    atomic_int next_todo;
+    long window_end;
+    bool_t quit;
+    int num_threads; /* the main thread and the workers that started */
+    pthread_mutex_t setup; /* held until the barriers are sized to num_threads */
+    pthread_barrier_t start, done;
+} tw_run_t;
+
+static void build_model(tw_run_t *run, pcb_t **pcbs, int num_procs, int num_init, int num_lps);
+static void assign_partitions(tw_run_t *run, pcb_t **pcbs, int num_lps);
+static void run_window(tw_run_t *run, tw_lp_t *lp);
+static void step(tw_run_t *run, tw_lp_t *lp);
+static bool_t res_free(tw_run_t *run, tw_lp_t *lp, int res);
+static void wake_waiters(tw_run_t *run, tw_lp_t *lp, int res);
+static void add_event(tw_lp_t *lp, tw_event_kind_t kind, int proc, int res);
+static void make_ready(tw_run_t *run, tw_lp_t *lp, int proc, tw_event_kind_t kind);
+static void save_lp(tw_run_t *run, tw_lp_t *lp);
+static void restore_lp(tw_run_t *run, tw_lp_t *lp);
+static void build_table(tw_run_t *run, tw_table_t *table);
+static bool_t busy_in(const tw_table_t *table, int res, long key, int lp);
+static void clear_table(tw_run_t *run, tw_table_t *table);
+static void commit_window(tw_run_t *run);
+static void run_pass(tw_run_t *run);
+static void *tw_worker(void *arg);
+static int compare_events(const void *a, const void *b);
+
+/**
+ * @brief Runs the workload with optimistic parallel simulation.
+ *
+ * @param init_procs The processes that are ready at the start
+ * @param arrivals The processes that arrive while simulating, one per tick
+ * @param algorithm PRIOR for preemptive priority, otherwise FCFS per partition
+ * @param num_threads The number of partitions/threads, 0 for one per processor
+ */
+void schedule_time_warp(pcb_t *init_procs, pcb_t *arrivals, schedule_t algorithm, int num_threads)
+{
+    tw_run_t run;
+    tw_table_t table;
+    pcb_t **pcbs, *pcb;
+    pthread_t *workers;
+    long windows = 0, rollbacks = 0, passes, max_passes;
+    int num_procs = 0, num_init, num_shared = 0;
+    int i, p, q, executed, live;
+    bool_t converged;
+
+    for (pcb = init_procs; pcb != NULL; pcb = pcb_next(pcb)) num_procs++;
+    num_init = num_procs;
+    for (pcb = arrivals; pcb != NULL; pcb = pcb_next(pcb)) num_procs++;
+    if (num_procs == 0) return;
+
+    pcbs = malloc(num_procs * sizeof(pcb_t *));
+    i = 0;
+    for (pcb = init_procs; pcb != NULL; pcb = pcb_next(pcb)) pcbs[i++] = pcb;
+    for (pcb = arrivals; pcb != NULL; pcb = pcb_next(pcb)) pcbs[i++] = pcb;
+
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0) num_threads = 1;
+    if (num_threads > num_procs) num_threads = num_procs;
+
+    memset(&run, 0, sizeof(tw_run_t));
+    run.priority_sched = (algorithm == PRIOR) ? TRUE : FALSE;
+    build_model(&run, pcbs, num_procs, num_init, num_threads);
+    for (i = 0; i < run.num_res; i++) if (run.shared[i]) num_shared++;
+
+    printf("Time Warp: %d partition(s), %d shared resource(s), window of %d ticks\n",
+           run.num_lps, num_shared, TW_WINDOW);
+
+    table.intervals = calloc(run.num_res, sizeof(tw_interval_t *));
+    table.count = calloc(run.num_res, sizeof(int));
+    table.cap = calloc(run.num_res, sizeof(int));
+    run.todo = malloc(run.num_lps * sizeof(int));
+
+    /* The workers wait for the barriers, which count only the threads that
+       started: a pass is shared out by next_todo, so fewer threads still
+       run every partition */
+    pthread_mutex_init(&run.setup, NULL);
+    pthread_mutex_lock(&run.setup);
+    workers = malloc(run.num_lps * sizeof(pthread_t));
+    for (i = 1; i < run.num_lps; i++) {
+        if (pthread_create(&workers[i], NULL, tw_worker, &run) != 0) {
+            fprintf(stderr, "Error: could not start worker thread %d\n", i);
+            break;
+        }
+    }
+    run.num_threads = i;
+    pthread_barrier_init(&run.start, NULL, run.num_threads);
+    pthread_barrier_init(&run.done, NULL, run.num_threads);
+    pthread_mutex_unlock(&run.setup);
+
+    /* At most one wrong assumption per key can be corrected per pass */
+    max_passes = (long)TW_WINDOW * run.num_lps + 1;
+
+    for (;;) {
+        run.window_end = run.lps[0].saved_now + TW_WINDOW;
+
+        /* The first pass assumes the others keep what they hold at the GVT */
+        clear_table(&run, &table);
+        build_table(&run, &table);
+        run.view = &table;
+        run.num_todo = run.num_lps;
+        for (p = 0; p < run.num_lps; p++) run.todo[p] = p;
+
+        converged = FALSE;
+        for (passes = 0; passes < max_passes && !converged; passes++) {
+            run_pass(&run);
+
+            /* Combine the events of all partitions and check every query */
+            clear_table(&run, &table);
+            build_table(&run, &table);
+            run.num_todo = 0;
+            for (p = 0; p < run.num_lps; p++) {
+                tw_lp_t *lp = &run.lps[p];
+                for (q = 0; q < lp->num_queries; q++) {
+                    if (busy_in(&table, lp->queries[q].res, lp->queries[q].key, p) != lp->queries[q].busy) {
+                        run.todo[run.num_todo++] = p;
+                        break;
+                    }
+                }
+            }
+            rollbacks += run.num_todo;
+            converged = (run.num_todo == 0) ? TRUE : FALSE;
+        }
+        if (!converged) {
+            printf("Error: Time Warp window did not converge\n");
+            break;
+        }
+
+        executed = 0;
+        live = 0;
+        for (p = 0; p < run.num_lps; p++) executed += run.lps[p].executed;
+        commit_window(&run);
+        windows++;
+
+        for (i = 0; i < run.num_procs; i++) if (run.state[i].state != TERMINATED) live++;
+        if (live == 0) break;
+        if (executed == 0) {
+            /* Nothing moved in a whole window, so nothing ever will */
+            log_deadlock_detected();
+            for (i = 0; i < run.num_procs; i++) {
+                if (run.state[i].state == WAITING) printf(" %s", pcb_mem(run.procs[i].pcb)->name);
+            }
+            printf("\n");
+            break;
+        }
+    }
+
+    run.quit = TRUE;
+    pthread_barrier_wait(&run.start);
+    for (i = 1; i < run.num_threads; i++) pthread_join(workers[i], NULL);
+    pthread_barrier_destroy(&run.start);
+    pthread_barrier_destroy(&run.done);
+    pthread_mutex_destroy(&run.setup);
+
+    printf("Time Warp: %ld window(s), %ld rollback(s), GVT %ld\n",
+           windows, rollbacks, run.lps[0].saved_now);
+
+    clear_table(&run, &table);
+    for (i = 0; i < run.num_res; i++) free(table.intervals[i]);
+    free(table.intervals);
+    free(table.count);
+    free(table.cap);
+    for (p = 0; p < run.num_lps; p++) {
+        tw_lp_t *lp = &run.lps[p];
+        free(lp->procs);
+        free(lp->arrivals);
+        free(lp->holder);
+        free(lp->saved_holder);
+        free(lp->saved_procs);
+        free(lp->events);
+        free(lp->queries);
+    }
+    for (i = 0; i < run.num_procs; i++) free(run.procs[i].instrs);
+    free(run.lps);
+    free(run.procs);
+    free(run.state);
+    free(run.res_names);
+    free(run.shared);
+    free(run.todo);
+    free(workers);
+    free(pcbs);
+}
+
+/**
+ * @brief Converts the pcbs into the compact model and splits them over the
+ *        partitions.
+ *
+ * A request of several resources becomes one request per resource, in the
+ * order they are named, so it is not atomic in a time warp run. A tryreq or
+ * a timed request waits like a plain request, and a reqs is exclusive.
+ * Resources in a hierarchy are independent here: no intention locks are
+ * taken on their ancestors.
+ */
+static void build_model(tw_run_t *run, pcb_t **pcbs, int num_procs, int num_init, int num_lps)
+{
+    name_table_t names;
+    instr_t *instr;
+    tw_lp_t *lp;
+    int *seen_by;
+    int i, k, n, r, p, num_instrs = 0;
+
+    for (i = 0; i < num_procs; i++) {
+        for (instr = pcb_mem(pcbs[i])->first_instr; instr != NULL; instr = instr->next) {
+            num_instrs += instr->set_size ? instr->set_size : 1;
+        }
+    }
+
+    run->num_procs = num_procs;
+    run->procs = calloc(num_procs, sizeof(tw_proc_t));
+    run->state = calloc(num_procs, sizeof(tw_proc_state_t));
+    run->res_names = malloc((num_instrs + 1) * sizeof(char *));
+
+    init_name_table(&names);
+    for (i = 0; i < num_procs; i++) {
+        run->procs[i].pcb = pcbs[i];
+        n = 0;
+        for (instr = pcb_mem(pcbs[i])->first_instr; instr != NULL; instr = instr->next) {
+            n += instr->set_size ? instr->set_size : 1;
+        }
+        run->procs[i].instrs = malloc((n + 1) * sizeof(tw_instr_t));
+        n = 0;
+        for (instr = pcb_mem(pcbs[i])->first_instr; instr != NULL; instr = instr->next) {
+            for (k = 0; k < (instr->set_size ? instr->set_size : 1); k++) {
+                r = name_to_id(&names, instr->set_size ? instr->set_names[k] : instr->resource_name);
+                if (r < 0) continue; /* reported, and left out of the model */
+                run->res_names[r] = instr->set_size ? instr->set_names[k] : instr->resource_name;
+                run->procs[i].instrs[n].type = instr->type;
+                run->procs[i].instrs[n].res = r;
+                n++;
+            }
+        }
+        run->procs[i].num_instrs = n;
+        run->state[i].pc = 0;
+        run->state[i].state = (i < num_init) ? READY : NEW;
+        run->state[i].seq = i;
+    }
+    run->num_res = names.count;
+    free_name_table(&names);
+
+    run->num_lps = num_lps;
+    run->lps = calloc(num_lps, sizeof(tw_lp_t));
+    assign_partitions(run, pcbs, num_lps);
+
+    for (p = 0; p < num_lps; p++) {
+        lp = &run->lps[p];
+        lp->id = p;
+        lp->procs = malloc((num_procs + 1) * sizeof(int));
+        lp->arrivals = malloc((num_procs + 1) * sizeof(int));
+        lp->holder = malloc((run->num_res + 1) * sizeof(int));
+        lp->saved_holder = malloc((run->num_res + 1) * sizeof(int));
+        for (r = 0; r < run->num_res; r++) lp->holder[r] = TW_NONE;
+        lp->running = TW_NONE;
+        lp->next_seq = num_procs;
+    }
+    for (i = 0; i < num_procs; i++) {
+        lp = &run->lps[run->procs[i].lp];
+        lp->procs[lp->num_procs++] = i;
+        if (i >= num_init) lp->arrivals[lp->num_arrivals++] = i;
+    }
+
+    /* A resource named by more than one partition is shared */
+    run->shared = calloc(run->num_res + 1, sizeof(bool_t));
+    seen_by = malloc((run->num_res + 1) * sizeof(int));
+    for (r = 0; r < run->num_res; r++) seen_by[r] = TW_NONE;
+    for (i = 0; i < num_procs; i++) {
+        for (n = 0; n < run->procs[i].num_instrs; n++) {
+            r = run->procs[i].instrs[n].res;
+            if (seen_by[r] == TW_NONE) seen_by[r] = run->procs[i].lp;
+            else if (seen_by[r] != run->procs[i].lp) run->shared[r] = TRUE;
+        }
+    }
+    free(seen_by);
+
+    for (p = 0; p < num_lps; p++) {
+        lp = &run->lps[p];
+        lp->saved_procs = malloc((lp->num_procs + 1) * sizeof(tw_proc_state_t));
+        save_lp(run, lp);
+    }
+}
+
+/**
+ * @brief Splits the processes over the partitions.
+ *
+ * Whole connected components are placed on the least loaded partition,
+ * largest first, so that independent groups do not need to roll back at
+ * all. A component that is larger than a fair share is spread process by
+ * process instead; its resources then become shared.
+ */
+static void assign_partitions(tw_run_t *run, pcb_t **pcbs, int num_lps)
+{
+    int *component, *weight, *order, *load;
+    int num_components, total = 0, fair;
+    int i, j, c, tmp, best;
+
+    component = malloc(run->num_procs * sizeof(int));
+    num_components = label_components(pcbs, run->num_procs, component);
+    weight = calloc(num_components, sizeof(int));
+    order = malloc(num_components * sizeof(int));
+    load = calloc(num_lps, sizeof(int));
+
+    for (i = 0; i < run->num_procs; i++) {
+        weight[component[i]] += run->procs[i].num_instrs + 1;
+        total += run->procs[i].num_instrs + 1;
+    }
+    fair = (total + num_lps - 1) / num_lps;
+
+    /* Heaviest component first, ties in load order */
+    for (c = 0; c < num_components; c++) order[c] = c;
+    for (i = 1; i < num_components; i++) {
+        tmp = order[i];
+        for (j = i; j > 0 && weight[order[j - 1]] < weight[tmp]; j--) order[j] = order[j - 1];
+        order[j] = tmp;
+    }
+
+    for (j = 0; j < num_components; j++) {
+        c = order[j];
+        if (weight[c] <= fair) {
+            best = 0;
+            for (i = 1; i < num_lps; i++) if (load[i] < load[best]) best = i;
+            for (i = 0; i < run->num_procs; i++) if (component[i] == c) run->procs[i].lp = best;
+            load[best] += weight[c];
+        } else {
+            for (i = 0; i < run->num_procs; i++) {
+                if (component[i] != c) continue;
+                best = 0;
+                for (tmp = 1; tmp < num_lps; tmp++) if (load[tmp] < load[best]) best = tmp;
+                run->procs[i].lp = best;
+                load[best] += run->procs[i].num_instrs + 1;
+            }
+        }
+    }
+
+    free(component);
+    free(weight);
+    free(order);
+    free(load);
+}
+
+/**
+ * @brief Runs one pass over the partitions in run->todo on all threads
+ */
+static void run_pass(tw_run_t *run)
+{
+    int i;
+
+    atomic_store(&run->next_todo, 0);
+    pthread_barrier_wait(&run->start);
+    while ((i = atomic_fetch_add(&run->next_todo, 1)) < run->num_todo) {
+        run_window(run, &run->lps[run->todo[i]]);
+    }
+    pthread_barrier_wait(&run->done);
+}
+
+/**
+ * @brief Worker thread: reruns partitions whenever the main thread starts a pass
+ */
+static void *tw_worker(void *arg)
+{
+    tw_run_t *run = arg;
+    int i;
+
+    pthread_mutex_lock(&run->setup);
+    pthread_mutex_unlock(&run->setup);
+    for (;;) {
+        pthread_barrier_wait(&run->start);
+        if (run->quit) break;
+        while ((i = atomic_fetch_add(&run->next_todo, 1)) < run->num_todo) {
+            run_window(run, &run->lps[run->todo[i]]);
+        }
+        pthread_barrier_wait(&run->done);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Simulates the current window of a partition from its saved state
+ */
+static void run_window(tw_run_t *run, tw_lp_t *lp)
+{
+    restore_lp(run, lp);
+    while (lp->now < run->window_end) step(run, lp);
+}
+
+/**
+ * @brief Simulates one tick of a partition
+ *
+ * Mirrors the manager: processes waiting on a freed resource become ready,
+ * the scheduler picks a process, it executes one instruction and one new
+ * process may arrive.
+ */
+static void step(tw_run_t *run, tw_lp_t *lp)
+{
+    tw_proc_state_t *ps;
+    tw_instr_t *instr;
+    int i, proc, best;
+
+    /* Processes waiting on a shared resource poll the other partitions */
+    for (i = 0; i < lp->num_procs; i++) {
+        proc = lp->procs[i];
+        ps = &run->state[proc];
+        if (ps->state == WAITING) {
+            instr = &run->procs[proc].instrs[ps->pc];
+            if (run->shared[instr->res] && res_free(run, lp, instr->res)) make_ready(run, lp, proc, EV_READY);
+        }
+    }
+
+    /* Pick the process to run */
+    for (;;) {
+        best = TW_NONE;
+        for (i = 0; i < lp->num_procs; i++) {
+            proc = lp->procs[i];
+            ps = &run->state[proc];
+            if (ps->state != READY) continue;
+            if (best == TW_NONE
+                || (run->priority_sched && run->procs[proc].pcb->priority > run->procs[best].pcb->priority)
+                || ((!run->priority_sched || run->procs[proc].pcb->priority == run->procs[best].pcb->priority)
+                    && ps->seq < run->state[best].seq)) {
+                best = proc;
+            }
+        }
+        if (best != TW_NONE && (lp->running == TW_NONE || (run->priority_sched
+            && run->procs[best].pcb->priority > run->procs[lp->running].pcb->priority))) {
+            if (lp->running != TW_NONE) make_ready(run, lp, lp->running, EV_READY);
+            lp->running = best;
+            run->state[best].state = RUNNING;
+        }
+        if (lp->running == TW_NONE) break;
+
+        ps = &run->state[lp->running];
+        if (ps->pc < run->procs[lp->running].num_instrs) break;
+        ps->state = TERMINATED;
+        add_event(lp, EV_TERMINATED, lp->running, TW_NONE);
+        lp->running = TW_NONE;
+    }
+
+    /* Execute one instruction */
+    if (lp->running != TW_NONE) {
+        proc = lp->running;
+        ps = &run->state[proc];
+        instr = &run->procs[proc].instrs[ps->pc];
+        switch (instr->type) {
+        case REQ_OP:
+            if (res_free(run, lp, instr->res)) {
+                lp->holder[instr->res] = proc;
+                add_event(lp, EV_ACQUIRED, proc, instr->res);
+                ps->pc++;
+            } else {
+                ps->state = WAITING;
+                add_event(lp, EV_WAITING, proc, instr->res);
+                lp->running = TW_NONE;
+            }
+            break;
+        case REL_OP:
+            if (lp->holder[instr->res] == proc) {
+                lp->holder[instr->res] = TW_NONE;
+                add_event(lp, EV_RELEASED, proc, instr->res);
+                wake_waiters(run, lp, instr->res);
+            } else {
+                add_event(lp, EV_REL_ERROR, proc, instr->res);
+            }
+            ps->pc++;
+            break;
+        default:
+            ps->pc++;
+            break;
+        }
+        lp->executed++;
+
+        if (lp->running != TW_NONE && ps->pc == run->procs[proc].num_instrs) {
+            ps->state = TERMINATED;
+            add_event(lp, EV_TERMINATED, proc, TW_NONE);
+            lp->running = TW_NONE;
+        }
+    }
+
+    /* One new process may arrive per tick */
+    if (lp->next_arrival < lp->num_arrivals) {
+        proc = lp->arrivals[lp->next_arrival++];
+        add_event(lp, EV_ARRIVED, proc, TW_NONE);
+        make_ready(run, lp, proc, EV_READY);
+        lp->executed++;
+    }
+
+    lp->now++;
+}
+
+/**
+ * @brief Is res free for the partition at its current key?
+ *
+ * Private resources only depend on the partition itself. For a shared
+ * resource the answer assumed about the other partitions is recorded so that
+ * it can be checked when the window ends.
+ */
+static bool_t res_free(tw_run_t *run, tw_lp_t *lp, int res)
+{
+    tw_query_t *query, *grown;
+    long key = lp->now * run->num_lps + lp->id;
+    bool_t busy;
+
+    if (lp->holder[res] != TW_NONE) return FALSE;
+    if (!run->shared[res]) return TRUE;
+
+    busy = busy_in(run->view, res, key, lp->id);
+    if (lp->num_queries == lp->cap_queries) {
+        grown = realloc(lp->queries, (lp->cap_queries ? 2 * lp->cap_queries : 64) * sizeof(tw_query_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for Time Warp queries\n");
+            exit(EXIT_FAILURE);
+        }
+        lp->queries = grown;
+        lp->cap_queries = lp->cap_queries ? 2 * lp->cap_queries : 64;
+    }
+    query = &lp->queries[lp->num_queries++];
+    query->key = key;
+    query->res = res;
+    query->busy = busy;
+
+    return busy ? FALSE : TRUE;
+}
+
+/**
+ * @brief Makes every process of the partition that waits on res ready
+ */
+static void wake_waiters(tw_run_t *run, tw_lp_t *lp, int res)
+{
+    tw_proc_state_t *ps;
+    int i, proc;
+
+    for (i = 0; i < lp->num_procs; i++) {
+        proc = lp->procs[i];
+        ps = &run->state[proc];
+        if (ps->state == WAITING && run->procs[proc].instrs[ps->pc].res == res) {
+            make_ready(run, lp, proc, EV_READY);
+        }
+    }
+}
+
+/**
+ * @brief Moves proc to the back of the ready processes of its partition
+ */
+static void make_ready(tw_run_t *run, tw_lp_t *lp, int proc, tw_event_kind_t kind)
+{
+    run->state[proc].state = READY;
+    run->state[proc].seq = lp->next_seq++;
+    add_event(lp, kind, proc, TW_NONE);
+}
+
+/**
+ * @brief Appends an event to the partition's history of this window
+ */
+static void add_event(tw_lp_t *lp, tw_event_kind_t kind, int proc, int res)
+{
+    tw_event_t *event, *grown;
+
+    if (lp->num_events == lp->cap_events) {
+        grown = realloc(lp->events, (lp->cap_events ? 2 * lp->cap_events : 64) * sizeof(tw_event_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for Time Warp events\n");
+            exit(EXIT_FAILURE);
+        }
+        lp->events = grown;
+        lp->cap_events = lp->cap_events ? 2 * lp->cap_events : 64;
+    }
+    event = &lp->events[lp->num_events];
+    event->key = lp->now;
+    event->kind = kind;
+    event->proc = proc;
+    event->res = res;
+    event->order = lp->num_events++;
+}
+
+/**
+ * @brief Saves the state of a partition at the GVT
+ */
+static void save_lp(tw_run_t *run, tw_lp_t *lp)
+{
+    int i;
+
+    lp->saved_now = lp->now;
+    lp->saved_running = lp->running;
+    lp->saved_next_arrival = lp->next_arrival;
+    lp->saved_next_seq = lp->next_seq;
+    memcpy(lp->saved_holder, lp->holder, run->num_res * sizeof(int));
+    for (i = 0; i < lp->num_procs; i++) lp->saved_procs[i] = run->state[lp->procs[i]];
+}
+
+/**
+ * @brief Rolls a partition back to its state at the GVT, dropping its history
+ */
+static void restore_lp(tw_run_t *run, tw_lp_t *lp)
+{
+    int i;
+
+    lp->now = lp->saved_now;
+    lp->running = lp->saved_running;
+    lp->next_arrival = lp->saved_next_arrival;
+    lp->next_seq = lp->saved_next_seq;
+    memcpy(lp->holder, lp->saved_holder, run->num_res * sizeof(int));
+    for (i = 0; i < lp->num_procs; i++) run->state[lp->procs[i]] = lp->saved_procs[i];
+    lp->num_events = 0;
+    lp->num_queries = 0;
+    lp->executed = 0;
+}
+
+/**
+ * @brief Adds a hold to the table
+ */
+static void add_interval(tw_table_t *table, int res, long start, int lp)
+{
+    tw_interval_t *interval, *grown;
+
+    if (table->count[res] == table->cap[res]) {
+        grown = realloc(table->intervals[res], (table->cap[res] ? 2 * table->cap[res] : 8) * sizeof(tw_interval_t));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed for Time Warp holds\n");
+            exit(EXIT_FAILURE);
+        }
+        table->intervals[res] = grown;
+        table->cap[res] = table->cap[res] ? 2 * table->cap[res] : 8;
+    }
+    interval = &table->intervals[res][table->count[res]++];
+    interval->start = start;
+    interval->end = TW_NEVER;
+    interval->lp = lp;
+}
+
+/**
+ * @brief Builds the holds of the shared resources: those open at the GVT
+ *        followed by the events of every partition in this window
+ */
+static void build_table(tw_run_t *run, tw_table_t *table)
+{
+    tw_lp_t *lp;
+    tw_event_t *event;
+    int p, e, i, res;
+
+    for (p = 0; p < run->num_lps; p++) {
+        lp = &run->lps[p];
+        for (res = 0; res < run->num_res; res++) {
+            if (run->shared[res] && lp->saved_holder[res] != TW_NONE) add_interval(table, res, -1, p);
+        }
+        for (e = 0; e < lp->num_events; e++) {
+            event = &lp->events[e];
+            if (event->res == TW_NONE || !run->shared[event->res]) continue;
+            if (event->kind == EV_ACQUIRED) {
+                add_interval(table, event->res, event->key * run->num_lps + p, p);
+            } else if (event->kind == EV_RELEASED) {
+                for (i = table->count[event->res] - 1; i >= 0; i--) {
+                    if (table->intervals[event->res][i].lp == p) {
+                        table->intervals[event->res][i].end = event->key * run->num_lps + p;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Is res held by a partition other than lp at key?
+ */
+static bool_t busy_in(const tw_table_t *table, int res, long key, int lp)
+{
+    tw_interval_t *interval;
+    int i;
+
+    for (i = 0; i < table->count[res]; i++) {
+        interval = &table->intervals[res][i];
+        if (interval->lp != lp && interval->start < key && key < interval->end) return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Empties the table, keeping its memory
+ */
+static void clear_table(tw_run_t *run, tw_table_t *table)
+{
+    int res;
+
+    for (res = 0; res < run->num_res; res++) table->count[res] = 0;
+}
+
+/**
+ * @brief Commits the window: logs its events in key order, advances the GVT
+ *        and reclaims the history of every partition.
+ */
+static void commit_window(tw_run_t *run)
+{
+    tw_event_t *all, *event;
+    char *name, *res_name;
+    int num = 0, p, e;
+
+    for (p = 0; p < run->num_lps; p++) num += run->lps[p].num_events;
+    all = malloc((num + 1) * sizeof(tw_event_t));
+    num = 0;
+    for (p = 0; p < run->num_lps; p++) {
+        for (e = 0; e < run->lps[p].num_events; e++) {
+            all[num] = run->lps[p].events[e];
+            all[num].key = all[num].key * run->num_lps + p;
+            num++;
+        }
+    }
+    qsort(all, num, sizeof(tw_event_t), compare_events);
+
+    for (e = 0; e < num; e++) {
+        event = &all[e];
+        name = pcb_mem(run->procs[event->proc].pcb)->name;
+        res_name = (event->res == TW_NONE) ? NULL : run->res_names[event->res];
+        switch (event->kind) {
+        case EV_ARRIVED: log_arrival(name); break;
+        case EV_READY: log_request_ready(name); break;
+        case EV_ACQUIRED: log_request_acquired(name, "req", res_name); break;
+        case EV_WAITING: log_request_waiting(name, "req", res_name); break;
+        case EV_RELEASED: log_release_released(name, res_name); break;
+        case EV_REL_ERROR: log_release_error(name, res_name); break;
+        case EV_TERMINATED: log_terminated(name); break;
+        }
+    }
+    free(all);
+
+    for (p = 0; p < run->num_lps; p++) {
+        save_lp(run, &run->lps[p]);
+        run->lps[p].num_events = 0;
+        run->lps[p].num_queries = 0;
+    }
+}
+
+/**
+ * @brief Orders events by key, then by their order within the partition
+ */
+static int compare_events(const void *a, const void *b)
+{
+    const tw_event_t *ea = a, *eb = b;
+
+    if (ea->key != eb->key) return ea->key < eb->key ? -1 : 1;
+    return ea->order - eb->order;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file time_warp.h
+ * @description Optimistic parallel simulation of a workload whose processes
+ *              interact through shared resources.
+ */
+#ifndef _TIME_WARP_H
+#define _TIME_WARP_H
+
+#include "proc_structs.h"
+#include "manager.h"
+
+/** Ticks simulated optimistically between two commits (GVT advances) */
+#ifndef TW_WINDOW
+#define TW_WINDOW 64
+#endif
+
+/**
+ * Splits the workload over <code>num_threads</code> partitions that run
+ * speculatively on their own threads and roll back on causality violations.
+ */
+void schedule_time_warp(pcb_t *procs_loaded, pcb_t *procs_arriving,
+                        schedule_t algorithm, int num_threads);
+
+#endif